@@ -0,0 +1,299 @@
+﻿#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <assert.h>
+#include "decimal_for_cpp/decimal.h"
+
+#include "Money.hpp"
+#include "AndOrTree.hpp"
+#include "SolutionIterator.hpp"
+
+using namespace vehicle::core;
+using namespace vehicle::algorithm;
+
+/** Содержимое узла дерева (см. modeltest). */
+class ItemValue {
+public:
+    explicit ItemValue(std::string title, bool fixed = false):
+        title(title),
+        fixed(fixed) {}
+
+    bool isFixed() const { return fixed; }
+
+    std::string title;
+    bool fixed;
+};
+
+typedef AndOrTree<decimal2, ItemValue> AOTree;
+typedef SolutionIterator<decimal2, ItemValue> solution_iterator;
+
+/** Возвращает значение атрибута name открывающего тега tag, либо пустую строку. */
+std::string attribute(const std::string &tag, const std::string &name) {
+    std::string prefix = " " + name + "=\"";
+    size_t begin = tag.find(prefix);
+    if (begin == std::string::npos) { return std::string(); }
+    begin += prefix.size();
+    size_t end = tag.find('"', begin);
+    return end == std::string::npos ? std::string() : tag.substr(begin, end - begin);
+}
+
+/**
+ * Загружает дерево из XML-файла модели (data.xml): узлы node с атрибутами
+ * type, name и value. Упрощённый разбор без Qt, достаточный для замеров;
+ * узлы типа mark и model, как и в utils::XmlParser, становятся ИЛИ-узлами.
+ */
+bool loadModel(const std::string &fileName, AOTree &tree) {
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    if (!file) { return false; }
+    std::string xml((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::vector<AOTree::node_t *> parents;
+    for (size_t pos = xml.find('<'); pos != std::string::npos; pos = xml.find('<', pos + 1)) {
+        if (xml.compare(pos, 7, "</node>") == 0) {
+            if (parents.empty()) { return false; }
+            parents.pop_back();
+            continue;
+        }
+        if (xml.compare(pos, 6, "<node ") != 0) { continue; }
+        size_t end = xml.find('>', pos);
+        if (end == std::string::npos) { return false; }
+        std::string tag = xml.substr(pos, end - pos);
+        bool closed = tag[tag.size() - 1] == '/';
+
+        std::string type = attribute(tag, "type");
+        NodeKind kind = NodeKind::NONE;
+        if (type == "AND") {
+            kind = NodeKind::AND;
+        } else if (type == "OR" || type == "mark" || type == "model") {
+            kind = NodeKind::OR;
+        }
+        std::string value = attribute(tag, "value");
+        auto node = tree.create(kind, decimal2(value.empty() ? 0 : std::stoi(value)),
+                                ItemValue(attribute(tag, "name")));
+        if (parents.empty()) {
+            if (tree.getRoot()) { return false; }
+            tree.setRoot(node);
+        } else {
+            parents.back()->attach(node);
+        }
+        if (!closed) { parents.push_back(node); }
+    }
+    return tree.getRoot() && parents.empty();
+}
+
+/** И-узел из options ИЛИ-узлов по choices листьев: типичный набор опций. */
+template <typename Tree>
+typename Tree::node_t * optionGroup(Tree &tree, size_t options, size_t choices, int seed) {
+    typedef typename Tree::key_t Key;
+    auto group = tree.create(NodeKind::AND, Key(0), ItemValue("options"));
+    for (size_t i = 0; i < options; i++) {
+        auto option = tree.create(NodeKind::OR, Key(0), ItemValue("option"));
+        for (size_t j = 0; j < choices; j++) {
+            option->append(NodeKind::NONE, Key((int)(seed + 37 * i + 11 * j) % 500), ItemValue("value"));
+        }
+        group->attach(option);
+    }
+    return group;
+}
+
+/** Плоское дерево: один набор опций. */
+template <typename Tree>
+void flatModel(Tree &tree, size_t options, size_t choices) {
+    tree.setRoot(optionGroup(tree, options, choices, 1));
+}
+
+/**
+ * Дерево, похожее на модели data.xml: выбор из models моделей, у каждой
+ * двигатель (ИЛИ из нескольких вариантов с вложенным выбором мощности)
+ * и набор опций.
+ */
+template <typename Tree>
+void catalogModel(Tree &tree, size_t models) {
+    typedef typename Tree::key_t Key;
+    auto root = tree.create(NodeKind::OR, Key(0), ItemValue("model"));
+    for (size_t m = 0; m < models; m++) {
+        auto model = tree.create(NodeKind::AND, Key(1000 + (int)m), ItemValue("model"));
+        auto engine = tree.create(NodeKind::OR, Key(0), ItemValue("engine"));
+        for (size_t e = 0; e < 2; e++) {
+            auto fuel = tree.create(NodeKind::AND, Key(0), ItemValue("fuel"));
+            fuel->attach(optionGroup(tree, 1, 3, (int)(m + e)));
+            engine->attach(fuel);
+        }
+        model->attach(engine);
+        model->attach(optionGroup(tree, 5, 3, (int)m));
+        root->attach(model);
+    }
+    tree.setRoot(root);
+}
+
+/**
+ * Перебирает решения дерева repeats раз (не более limit решений за проход)
+ * и возвращает среднее время на решение в наносекундах.
+ * @param checksum сумма стоимостей перебранных решений
+ */
+double measure(const AOTree &tree, bool unrolled, size_t limit, size_t repeats, decimal2 &checksum) {
+    typedef std::chrono::high_resolution_clock clock;
+    checksum = decimal2(0);
+    size_t total = 0;
+    clock::duration elapsed(0);
+    for (size_t r = 0; r < repeats; r++) {
+        // построение дерева решения в замер не входит
+        solution_iterator iter(tree);
+        iter.setUnrolledEnumeration(unrolled);
+        size_t count = 0;
+        auto start = clock::now();
+        do {
+            checksum = checksum + iter.currentSolution().getRoot()->subtreeKey();
+            count++;
+        } while (count < limit && iter.nextSolution());
+        elapsed += clock::now() - start;
+        total += count;
+    }
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / total;
+}
+
+void run(const std::string &name, const AOTree &tree) {
+    const size_t limit = 2000000;
+    // короткие деревья перебираются многократно, чтобы замер был не меньше limit решений
+    solution_iterator counter(tree);
+    size_t solutions = counter.solutionCount();
+    size_t perPass = solutions < limit ? solutions : limit;
+    size_t repeats = perPass ? (limit + perPass - 1) / perPass : 1;
+
+    decimal2 genericSum, unrolledSum;
+    double generic = measure(tree, false, limit, repeats, genericSum);
+    double unrolled = measure(tree, true, limit, repeats, unrolledSum);
+    assert(genericSum == unrolledSum);
+
+    std::cout << std::left << std::setw(20) << name << std::right
+              << std::setw(12) << solutions
+              << std::fixed << std::setprecision(1)
+              << std::setw(14) << generic
+              << std::setw(14) << unrolled
+              << std::setprecision(2)
+              << std::setw(10) << generic / unrolled << "x"
+              << (genericSum == unrolledSum ? "" : "  MISMATCH") << std::endl;
+}
+
+/** Время этапов работы с деревом для одного типа ключа. */
+struct KeyTimings {
+    /** Построение дерева (с пересчётом ключей поддеревьев), мс. */
+    double build;
+    /** Перебор решений со сбором стоимостей, нс на решение. */
+    double enumerate;
+    /** Сортировка собранных стоимостей, мс. */
+    double sort;
+    /** Сумма стоимостей в копейках - для сверки типов ключа. */
+    int64_t checksum;
+};
+
+/** Замеряет построение, перебор и сортировку по стоимости для ключа Key. */
+template <typename Key>
+KeyTimings measureKey(size_t models, size_t builds) {
+    typedef std::chrono::high_resolution_clock clock;
+    typedef AndOrTree<Key, ItemValue> tree_t;
+    KeyTimings result;
+
+    auto start = clock::now();
+    for (size_t b = 1; b < builds; b++) {
+        tree_t scratch;
+        catalogModel(scratch, models);
+    }
+    tree_t tree;
+    catalogModel(tree, models);
+    result.build = std::chrono::duration<double, std::milli>(clock::now() - start).count() / builds;
+
+    std::vector<Key> prices;
+    SolutionIterator<Key, ItemValue> iter(tree);
+    prices.reserve(iter.solutionCount());
+    start = clock::now();
+    do {
+        prices.push_back(iter.currentSolution().getRoot()->subtreeKey());
+    } while (iter.nextSolution());
+    result.enumerate = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count()
+        / prices.size();
+
+    start = clock::now();
+    std::sort(prices.begin(), prices.end());
+    result.sort = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+    result.checksum = 0;
+    for (size_t i = 0; i < prices.size(); i++) {
+        result.checksum += prices[i].getUnbiased() * (int64_t)(i % 7 + 1);
+    }
+    return result;
+}
+
+/** Сравнивает decimal2 и money2 в качестве ключа дерева. */
+void compareKeys(size_t models) {
+    const size_t builds = 200;
+    KeyTimings decimal = measureKey<decimal2>(models, builds);
+    KeyTimings money = measureKey<money2>(models, builds);
+
+    std::cout << std::endl << std::left << std::setw(20) << "key" << std::right
+              << std::setw(14) << "build, ms"
+              << std::setw(16) << "enumerate, ns"
+              << std::setw(14) << "sort, ms" << std::endl;
+    const KeyTimings *rows[] = { &decimal, &money };
+    const char *names[] = { "decimal2", "money2" };
+    for (size_t i = 0; i < 2; i++) {
+        std::cout << std::left << std::setw(20) << names[i] << std::right
+                  << std::fixed << std::setprecision(3)
+                  << std::setw(14) << rows[i]->build
+                  << std::setprecision(1)
+                  << std::setw(16) << rows[i]->enumerate
+                  << std::setprecision(2)
+                  << std::setw(14) << rows[i]->sort << std::endl;
+    }
+    std::cout << std::left << std::setw(20) << "speedup" << std::right
+              << std::setw(13) << decimal.build / money.build << "x"
+              << std::setw(15) << decimal.enumerate / money.enumerate << "x"
+              << std::setw(13) << decimal.sort / money.sort << "x"
+              << (decimal.checksum == money.checksum ? "" : "  MISMATCH") << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::string dataFile = argc > 1 ? argv[1] : "../trunk/data.xml";
+
+    std::cout << std::left << std::setw(20) << "tree" << std::right
+              << std::setw(12) << "solutions"
+              << std::setw(14) << "generic, ns"
+              << std::setw(14) << "unrolled, ns"
+              << std::setw(11) << "speedup" << std::endl;
+
+    AOTree data;
+    if (loadModel(dataFile, data)) {
+        run("data.xml", data);
+    } else {
+        std::cout << "Cannot load " << dataFile << std::endl;
+    }
+
+    AOTree flat2;
+    flatModel(flat2, 2, 5);
+    run("AND of 2 OR x5", flat2);
+
+    AOTree flat4;
+    flatModel(flat4, 4, 4);
+    run("AND of 4 OR x4", flat4);
+
+    AOTree flat8;
+    flatModel(flat8, 8, 3);
+    run("AND of 8 OR x3", flat8);
+
+    AOTree wide;
+    flatModel(wide, 12, 3);
+    run("AND of 12 OR x3", wide);
+
+    AOTree catalog;
+    catalogModel(catalog, 20);
+    run("catalog x20", catalog);
+
+    compareKeys(200);
+
+    return 0;
+}
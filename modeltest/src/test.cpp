@@ -1,9 +1,29 @@
-﻿#include <iostream>
+﻿#include <algorithm>
+#include <iostream>
+#include <sstream>
 #include <assert.h>
 #include "decimal_for_cpp/decimal.h"
 
 #include "AndOrTree.hpp"
 #include "SolutionIterator.hpp"
+#include "BranchAndBoundIterator.hpp"
+#include "ParallelEnumerator.hpp"
+#include "GrayCodeIterator.hpp"
+#include "SolutionSampler.hpp"
+#include "RuleSet.hpp"
+#include "PriceDistribution.hpp"
+#include "SolutionStream.hpp"
+#include "PriceKernel.hpp"
+#include "ClosestPriceSearch.hpp"
+#include "PriceExtremes.hpp"
+#include "DecisionDiagram.hpp"
+#include "ParetoFront.hpp"
+#include "BestValueSearch.hpp"
+#include "FacetStatistics.hpp"
+#include "SolutionDiff.hpp"
+#include "BatchPricing.hpp"
+#include "FactorizedSolutions.hpp"
+#include "Money.hpp"
 
 using namespace vehicle::core;
 using namespace vehicle::algorithm;
@@ -72,6 +92,328 @@ int main() {
     solution_iterator iter(copy);
 
 	assert(iter.solutionCount() == 4);
+
+    // перебор только тех решений, стоимость которых попадает в диапазон;
+    // альтернативы "baz" (1188) и "quax" (1199) отсекаются без перебора
+    typedef BranchAndBoundIterator<
+        typename AOTree::key_t,
+        typename AOTree::value_t> bounded_iterator;
+    bounded_iterator bounded(copy, PriceRange<decimal2>(decimal2(1140), decimal2(1160)));
+    assert(bounded.hasSolution());
+    assert(bounded.currentPrice() == decimal2(1150));
+    assert(bounded.currentSolution().getRoot()->subtreeKey() == decimal2(1150));
+    assert(bounded.nextSolution());
+    assert(bounded.currentPrice() == decimal2(1147));
+    assert(!bounded.nextSolution());
+
+    // переход к решению по номеру и параллельный перебор:
+    // решения выдаются в том же порядке, что и у итератора
+    solution_iterator last(copy);
+    last.seek(iter.solutionCount() - 1);
+    assert(!last.nextSolution());
+    ParallelEnumerator<
+        typename AOTree::key_t,
+        typename AOTree::value_t> parallel(copy, 2);
+    auto prices = parallel.map<decimal2>([] (const solution_iterator &it) {
+        return it.currentSolution().getRoot()->subtreeKey();
+    });
+    assert(prices.size() == iter.solutionCount());
+    assert(prices.front() == iter.currentSolution().getRoot()->subtreeKey());
+
+    // перебор в порядке кода Грея: соседние решения отличаются выбором
+    // одного ИЛИ-узла, стоимость получается из предыдущей одной разностью
+    GrayCodeIterator<
+        typename AOTree::key_t,
+        typename AOTree::value_t> gray(copy);
+    decimal2 graySum, pricesSum;
+    size_t grayCount = 0;
+    std::vector<size_t> grayChoices;
+    do {
+        assert(gray.currentPrice() == gray.currentSolution().getRoot()->subtreeKey());
+        auto choices = gray.currentView().choiceIndices();
+        if (grayCount > 0) {
+            size_t changed = 0;
+            for (size_t slot = 0; slot < choices.size(); slot++) {
+                if (choices[slot] != grayChoices[slot]) { changed++; }
+            }
+            assert(changed == 1);
+            assert(choices[gray.lastChangedSlot()] != grayChoices[gray.lastChangedSlot()]);
+        }
+        grayChoices = choices;
+        graySum += gray.currentPrice();
+        grayCount++;
+    } while (gray.nextSolution());
+    for (auto &price : prices) { pricesSum += price; }
+    assert(grayCount == prices.size());
+    assert(graySum == pricesSum);
+
+    // компактное представление решения: индексы выбранных альтернатив
+    // и стоимость, обход выбранных узлов исходного дерева
+    auto view = bounded.currentView();
+    decimal2 walkedPrice;
+    view.walk([&walkedPrice] (const AOTree::node_t *node) { walkedPrice += node->ownKey(); });
+    assert(view.totalPrice() == decimal2(1147));
+    assert(walkedPrice == view.totalPrice());
+
+    // случайная выборка: равномерная и взвешенная (альтернативы
+    // "baz" и "quax" с нулевым весом никогда не выбираются)
+    typedef SolutionSampler<
+        typename AOTree::key_t,
+        typename AOTree::value_t> solution_sampler;
+    solution_sampler uniform(copy, 42);
+    assert(uniform.weight() == iter.solutionCount());
+    // каждое из 4 решений выбирается примерно в четверти случаев
+    decimal2 samplePrices[] = { decimal2(1188), decimal2(1199), decimal2(1150), decimal2(1147) };
+    size_t sampleCounts[4] = { 0, 0, 0, 0 };
+    const size_t sampleTotal = 4000;
+    for (auto &sample : uniform.sample(sampleTotal)) {
+        auto found = std::find(samplePrices, samplePrices + 4, sample.totalPrice());
+        assert(found != samplePrices + 4);
+        sampleCounts[found - samplePrices]++;
+    }
+    for (size_t i = 0; i < 4; i++) {
+        assert(sampleCounts[i] > sampleTotal / 4 - 150 && sampleCounts[i] < sampleTotal / 4 + 150);
+    }
+    solution_sampler weighted(copy, 42, [] (const AOTree::node_t *node) {
+        return node->getValue().title == "baz" || node->getValue().title == "quax" ? 0.0 : 1.0;
+    });
+    for (auto &sample : weighted.sample(20)) {
+        assert(sample.totalPrice() == decimal2(1150) || sample.totalPrice() == decimal2(1147));
+    }
+
+    // правила совместимости: "baz" несовместим с "sel" (зафиксирован),
+    // "quax" требует "xyzzy" (не может быть выбран при зафиксированном "sel")
+    RuleSet<
+        typename AOTree::key_t,
+        typename AOTree::value_t> rules;
+    auto foo = copy.getRoot()->child(1), zyx = copy.getRoot()->child(3);
+    rules.exclude(foo->child(0), zyx->child(1));
+    rules.require(foo->child(1), zyx->child(0));
+    assert(countSolutions(copy, rules) == 2);
+    bounded_iterator constrained(copy, rules);
+    assert(constrained.hasSolution());
+    assert(constrained.currentPrice() == decimal2(1150));
+    assert(constrained.nextSolution());
+    assert(constrained.currentPrice() == decimal2(1147));
+    assert(!constrained.nextSolution());
+
+    // распределение стоимостей решений без перебора
+    PriceDistribution<
+        typename AOTree::key_t,
+        typename AOTree::value_t> distribution(copy);
+    assert(distribution.total() == iter.solutionCount());
+    assert(distribution.count(decimal2(1150)) == 1);
+    assert(distribution.minPrice() == decimal2(1147));
+    assert(distribution.maxPrice() == decimal2(1199));
+    assert(distribution.histogram(decimal2(10)).size() == 6);
+    // количество решений не дороже бюджета и в окне стоимостей
+    assert(distribution.countAtMost(decimal2(1150)) == 2);
+    assert(distribution.countAtMost(decimal2(1000)) == 0);
+    assert(distribution.countWithin(PriceRange<decimal2>(decimal2(1148), decimal2(1190))) == 2);
+
+    // потоковый перебор: пакетами и с досрочной остановкой
+    solution_iterator streamed(copy);
+    size_t batches = 0;
+    size_t streamedCount = forEachBatch(streamed, 3, [&batches] (const std::vector<solution_iterator::view_t> &batch) {
+        batches++;
+        return batch.size() <= 3;
+    });
+    assert(streamedCount == iter.solutionCount() && batches == 2);
+    solution_iterator stopped(copy);
+    assert(forEachSolution(stopped, [] (const solution_iterator &) { return false; }) == 1);
+
+    // сохранение состояния перебора и продолжение с того же решения
+    solution_iterator interrupted(copy);
+    interrupted.nextSolution();
+    interrupted.nextSolution();
+    std::stringstream saved;
+    saved << interrupted.checkpoint();
+    Checkpoint checkpoint;
+    saved >> checkpoint;
+    solution_iterator resumed(copy);
+    assert(resumed.restore(checkpoint));
+    assert(resumed.currentView().choiceIndices() == interrupted.currentView().choiceIndices());
+    size_t remaining = 0;
+    do { remaining++; } while (resumed.nextSolution());
+    assert(remaining == iter.solutionCount() - 2);
+
+    // пакетный расчёт стоимостей по плоской таблице
+    ChoiceLayout<decimal2, ItemValue> kernelLayout(copy.getRoot());
+    PriceKernel<decimal2, ItemValue> kernel(kernelLayout);
+    PriceBatch priceBatch(kernelLayout.size());
+    std::vector<decimal2> walkedPrices;
+    solution_iterator priced(copy);
+    do {
+        priceBatch.add(priced.currentView().choiceIndices());
+        walkedPrices.push_back(priced.currentSolution().getRoot()->subtreeKey());
+    } while (priced.nextSolution());
+    assert(kernel.evaluate(priceBatch) == walkedPrices);
+
+    // перебор поддеревьев фиксированной формы развёрнутыми счётчиками
+    solution_iterator generic(copy);
+    generic.setUnrolledEnumeration(false);
+    std::vector<decimal2> genericPrices;
+    do {
+        genericPrices.push_back(generic.currentSolution().getRoot()->subtreeKey());
+    } while (generic.nextSolution());
+    assert(genericPrices == walkedPrices);
+
+    // решения, ближайшие по стоимости к заданной
+    auto closest = closestSolutions(copy, decimal2(1160), 2);
+    assert(closest.size() == 2);
+    assert(closest[0].totalPrice() == decimal2(1150));
+    assert(closest[1].totalPrice() == decimal2(1147));
+
+    // самое дешёвое и самое дорогое решения без перебора
+    assert(cheapestSolution(copy).totalPrice() == decimal2(1147));
+    assert(mostExpensiveSolution(copy).totalPrice() == decimal2(1199));
+
+    // множество решений в виде диаграммы решений
+    DecisionDiagram<decimal2, ItemValue> diagram(copy);
+    assert(diagram.count() == iter.solutionCount());
+    assert(diagram.minPrice() == decimal2(1147) && diagram.maxPrice() == decimal2(1199));
+    assert((diagram.with(copy.getRoot()->child(0)) | diagram.without(copy.getRoot()->child(0))) == diagram);
+    DiagramIterator<decimal2, ItemValue> diagramSolutions(diagram);
+    std::vector<decimal2> diagramPrices;
+    do {
+        diagramPrices.push_back(diagramSolutions.currentView().totalPrice());
+    } while (diagramSolutions.nextSolution());
+    assert(diagramPrices == walkedPrices);
+
+    // Парето-оптимальные решения по стоимости и длине названий компонентов
+    std::vector<Criterion<ItemValue>> criteria;
+    criteria.push_back(Criterion<ItemValue>([] (const ItemValue &value) {
+        return (double)value.title.size();
+    }, Goal::Minimize));
+    auto pareto = paretoSolutions(copy, criteria);
+    assert(pareto.size() == 2);
+    assert(pareto[0].price() == decimal2(1147) && pareto[1].price() == decimal2(1188));
+    assert(pareto[0].attributes[0] > pareto[1].attributes[0]);
+
+    // решения с наибольшим баллом в пределах бюджета (балл - длина названия)
+    auto bestValue = bestValueSolutions<decimal2, ItemValue>(copy, [] (const ItemValue &value) {
+        return (int64_t)value.title.size();
+    }, decimal2(1190), 2);
+    assert(bestValue.size() == 2);
+    assert(bestValue[0].price() == decimal2(1147) && bestValue[1].price() == decimal2(1150));
+    assert(bestValue[0].score == bestValue[1].score);
+
+    // количество решений и наименьшая стоимость при выборе каждого значения
+    FacetStatistics<decimal2, ItemValue> facets(copy);
+    assert(facets.of(foo->child(0)).count == 1 && facets.of(foo->child(0)).minPrice == decimal2(1188));
+    assert(facets.of(foo->child(2)).count == 2 && facets.of(foo->child(2)).minPrice == decimal2(1147));
+    // выбор xyzzy вместо зафиксированного sel
+    assert(facets.of(zyx->child(0)).count == 4 && facets.of(zyx->child(0)).minPrice == decimal2(1146));
+    assert(facets.of(copy.getRoot()).count == iter.solutionCount());
+    // сводка по текущему множеству решений: xyzzy исключён зафиксированным sel
+    assert(facets.current(copy.getRoot()).minPrice == decimal2(1147));
+    assert(facets.current(copy.getRoot()).maxPrice == decimal2(1199));
+    assert(facets.current(zyx->child(0)).empty() && facets.current(zyx->child(1)).count == iter.solutionCount());
+    assert(facets.current(foo->child(1)).count == 1 && facets.current(foo->child(1)).maxPrice == decimal2(1199));
+
+    // изменение множества решений при снятии и установке фиксации без перебора
+    auto diffLayout = std::make_shared<const ChoiceLayout<decimal2, ItemValue>>(copy.getRoot());
+    auto fixedBefore = fixedState(*diffLayout);
+    zyx->child(1)->getValue().fixed = false;
+    auto fixedAfter = fixedState(*diffLayout);
+    auto released = diffSolutions(diffLayout, fixedBefore, fixedAfter);
+    assert(released.removed.empty() && released.added.size() == 1);
+    // добавлены решения с xyzzy и nonsel вместо sel
+    assert(released.added[0].count() == 2 * iter.solutionCount());
+    SubspaceIterator<decimal2, ItemValue> addedSolutions(released.added[0]);
+    size_t addedCount = 0;
+    do {
+        assert(addedSolutions.currentView().chosenChild(zyx) != zyx->child(1));
+        addedCount++;
+    } while (addedSolutions.nextSolution());
+    assert(addedCount == 2 * iter.solutionCount());
+    auto refixed = diffSolutions(diffLayout, fixedAfter, fixedBefore);
+    assert(refixed.added.empty() && refixed.removed.size() == 1 && refixed.removed[0].count() == 2 * iter.solutionCount());
+    zyx->child(1)->getValue().fixed = true;
+    // фиксация sel только сужает множество: решения отбираются без перебора
+    NarrowingFilter<decimal2, ItemValue> narrowing(diffLayout, fixedAfter, fixedBefore);
+    NarrowingFilter<decimal2, ItemValue> widening(diffLayout, fixedBefore, fixedAfter);
+    assert(narrowing.isNarrowing() && !widening.isNarrowing());
+    SubspaceIterator<decimal2, ItemValue> excluded(refixed.removed[0]);
+    do {
+        assert(!narrowing.accepts(excluded.currentView().choiceIndices()));
+    } while (excluded.nextSolution());
+    solution_iterator kept(copy);
+    do {
+        assert(narrowing.accepts(kept.currentView().choiceIndices()));
+    } while (kept.nextSolution());
+    // факторизованное множество решений: решение по номеру без перебора
+    auto factorized = std::make_shared<const FactorizedSolutions<decimal2, ItemValue>>(copy);
+    assert(factorized->count() == iter.solutionCount());
+    FactorizedIterator<decimal2, ItemValue> factorizedSolutions(factorized);
+    std::vector<decimal2> factorizedPrices;
+    do {
+        factorizedPrices.push_back(factorizedSolutions.currentView().totalPrice());
+    } while (factorizedSolutions.nextSolution());
+    assert(factorizedPrices == walkedPrices);
+    // 5 независимых групп по 10 альтернатив: 10^5 решений, 5 + 50 записей детей
+    AOTree groups;
+    groups.setRoot(groups.create(NodeKind::AND, decimal2(0), ItemValue("options")));
+    for (int g = 0; g < 5; g++) {
+        auto group = groups.create(NodeKind::OR, decimal2(0), ItemValue("group"));
+        for (int i = 0; i < 10; i++) {
+            group->append(NodeKind::NONE, decimal2(i), ItemValue("option"));
+        }
+        groups.getRoot()->attach(group);
+    }
+    FactorizedSolutions<decimal2, ItemValue> product(groups);
+    assert(product.count() == 100000 && product.size() == 55);
+    assert(product.at(99999).totalPrice() == decimal2(45));
+
+    // пакетный расчёт стоимостей заданных конфигураций по путям из названий
+    BatchPricing<decimal2, ItemValue> pricing(copy, [] (const ItemValue &value) { return value.title; });
+    std::vector<std::vector<std::string>> orders(5);
+    orders[0].push_back("foo/quax");
+    orders[0].push_back("zyx/xyzzy");
+    orders[1].push_back("foo/frob");
+    orders[1].push_back("foo/frob/xell");
+    orders[1].push_back("zyx/sel");
+    orders[2].push_back("foo/baz");
+    orders[3] = orders[1];
+    orders[3].push_back("foo/baz");
+    orders[4] = orders[0];
+    orders[4].push_back("foo/frob/crux");
+    auto quotes = pricing.price(orders);
+    assert(quotes[0].isValid() && quotes[0].price == decimal2(1198));
+    assert(quotes[1].isValid() && quotes[1].price == decimal2(1147));
+    assert(quotes[2].status == QuoteStatus::Incomplete);
+    assert(quotes[3].status == QuoteStatus::Conflict && quotes[3].item == 3);
+    assert(quotes[4].status == QuoteStatus::Unreachable);
+
+    // целочисленный денежный ключ вместо decimal2
+    AndOrTree<money2, ItemValue> moneyTree;
+    moneyTree.setRoot(moneyTree.create(NodeKind::AND, money2(42), ItemValue("hello"))
+        ->attach(moneyTree.create(NodeKind::OR, money2(33), ItemValue("foo"))
+            ->append(NodeKind::NONE, money2(44), ItemValue("baz"))
+            ->append(NodeKind::NONE, money2(55), ItemValue("quax")))
+        ->attach(moneyTree.create(NodeKind::OR, money2(3), ItemValue("zyx"))
+            ->append(NodeKind::NONE, money2(11), ItemValue("xyzzy"))
+            ->append(NodeKind::NONE, money2(13), ItemValue("nonsel"))));
+    assert(moneyTree.getRoot()->subtreeKey() == money2(133));
+    SolutionIterator<money2, ItemValue> moneySolutions(moneyTree);
+    std::vector<money2> moneyPrices;
+    do {
+        moneyPrices.push_back(moneySolutions.currentSolution().getRoot()->subtreeKey());
+    } while (moneySolutions.nextSolution());
+    std::sort(moneyPrices.begin(), moneyPrices.end());
+    assert(moneyPrices.size() == 4 && moneyPrices[0] == money2(133) && moneyPrices[3] == money2(146));
+    std::ostringstream moneyText;
+    moneyText << money2::fromUnits(-1205) << ' ' << moneyPrices[1];
+    assert(moneyText.str() == "-12.05 135.00");
+    assert((money2(7) / money2(2)).getAsInteger() == 4 && minOf(money2(3), money2(-2)) == money2(-2));
+    char moneyChars[money2::maxChars];
+    char *moneyEnd = toChars(moneyChars, moneyChars + money2::maxChars, money2::fromUnits(-1205));
+    assert(std::string(moneyChars, moneyEnd) == "-12.05");
+    money2 parsed;
+    const char *priceText = "503000 12.345";
+    assert(fromChars(priceText, priceText + 13, parsed) == priceText + 6 && parsed == money2(503000));
+    assert(fromChars(priceText + 7, priceText + 13, parsed) == priceText + 13 && parsed.getUnbiased() == 1235);
+    assert(fromChars(priceText + 6, priceText + 13, parsed) == nullptr);
     std::cout
         << "\nEnumerating " << iter.solutionCount()
         << " solutions: <press enter>" << std::endl;
@@ -112,6 +112,18 @@ namespace vehicle {
                 if (node->parent) { recomputeKey(node->parent); }
             }
 
+            /**
+             * Пересчитывает ключи узла node и его предков вплоть до узла
+             * stop, не включая его (например, при изменении нескольких узлов
+             * поддерева stop, после которого ключ stop и его предков
+             * пересчитывается один раз).
+             */
+            void recomputeKey(node_t *node, const node_t *stop) {
+                for (; node && node != stop; node = node->parent) {
+                    node->computedKey = computeKey(*node);
+                }
+            }
+
         private:
             void cloneFrom(const AndOrTree &source) {
                 if (source.root) {
@@ -0,0 +1,216 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+#include "PriceKernel.hpp"
+#include "WorkStealingPool.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /** Результат проверки набора выбранных альтернатив. */
+        enum class QuoteStatus {
+            /** Набор задаёт решение, стоимость рассчитана. */
+            Ok,
+            /** Узел не найден или не является альтернативой узла выбора. */
+            UnknownNode,
+            /** Путь из названий соответствует нескольким узлам. */
+            AmbiguousNode,
+            /** Для одного узла выбора выбрано несколько альтернатив. */
+            Conflict,
+            /** Для узла выбора, входящего в решение, альтернатива не выбрана. */
+            Incomplete,
+            /** Выбрана альтернатива узла выбора, не входящего в решение. */
+            Unreachable
+        };
+
+        /** Стоимость набора выбранных альтернатив; при status != Ok не определена. */
+        template <typename Key>
+        struct Quote {
+            Quote(): status(QuoteStatus::Ok), price(), item(0) {}
+
+            bool isValid() const { return status == QuoteStatus::Ok; }
+
+            QuoteStatus status;
+            Key price;
+            /** Номер ошибочного элемента набора (для UnknownNode, AmbiguousNode и Conflict). */
+            size_t item;
+        };
+
+        /**
+         * Пакетный расчёт стоимостей явно заданных конфигураций (заказы
+         * дилеров, импорт из CRM) без построения дерева решения на каждую.
+         * Конфигурация - набор выбранных альтернатив узлов выбора: узлов
+         * исходного дерева либо путей из названий узлов от ребёнка корня
+         * до альтернативы через separator ("BMW/X6/Двигатель/3.0d").
+         * Индексы узлов и путей строятся один раз в конструкторе; набор
+         * переводится в индексы альтернатив по разрядам ChoiceLayout,
+         * проверяется (альтернативы выбраны ровно для узлов выбора,
+         * входящих в решение) и рассчитывается по плоской таблице
+         * PriceKernel. Зафиксированные узлы не учитываются: конфигурация
+         * задана явно. Пакет делится на части, которые проверяются
+         * и рассчитываются параллельно пулом потоков.
+         * Индексы действительны, пока не изменялись дерево и его ключи.
+         */
+        template <typename Key, typename Value>
+        class BatchPricing {
+        public:
+            typedef AndOrTree<Key, Value> tree_t;
+            typedef Node<Key, Value> node_t;
+            typedef ChoiceLayout<Key, Value> layout_t;
+            typedef Quote<Key> quote_t;
+            typedef std::function<std::string(const Value &)> name_t;
+
+            /** Размер части пакета, обрабатываемой одним потоком за раз. */
+            static const size_t chunkSize = 256;
+
+            /**
+             * @param name функция, возвращающая название узла по его содержимому
+             * @param threadCount количество потоков; 0 - по количеству
+             *     аппаратных потоков процессора
+             */
+            BatchPricing(const tree_t &source, name_t name, char separator = '/', size_t threadCount = 0):
+                layout(source.getRoot()),
+                kernel(layout),
+                separator(separator),
+                pool(threadCount)
+            {
+                for (size_t slot = 0; slot < layout.size(); slot++) {
+                    const node_t *node = layout.node(slot);
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        alternatives[node->child(i)] = Alternative(slot, i);
+                    }
+                }
+                if (layout.root()) {
+                    for (auto child : *layout.root()) {
+                        indexPaths(child, name(child->getValue()), name);
+                    }
+                }
+            }
+
+            /** Возвращает стоимости конфигураций, заданных узлами исходного дерева. */
+            std::vector<quote_t> price(const std::vector<std::vector<const node_t *>> &configurations) const {
+                return price(configurations, [this] (const node_t *node) -> Alternative {
+                    auto found = alternatives.find(node);
+                    return found == alternatives.end() ? Alternative() : found->second;
+                });
+            }
+
+            /** Возвращает стоимости конфигураций, заданных путями из названий узлов. */
+            std::vector<quote_t> price(const std::vector<std::vector<std::string>> &configurations) const {
+                return price(configurations, [this] (const std::string &path) -> Alternative {
+                    auto found = paths.find(path);
+                    return found == paths.end() ? Alternative() : found->second;
+                });
+            }
+
+        private:
+            /** Разряд и индекс альтернативы; slot == npos - узел не найден. */
+            struct Alternative {
+                Alternative(): slot(layout_t::npos), index(0) {}
+                Alternative(size_t slot, size_t index): slot(slot), index(index) {}
+
+                bool isAmbiguous() const { return slot == layout_t::npos && index != 0; }
+
+                size_t slot;
+                size_t index;
+            };
+
+            void indexPaths(const node_t *node, const std::string &path, const name_t &name) {
+                auto found = alternatives.find(node);
+                if (found != alternatives.end()) {
+                    auto inserted = paths.insert(std::make_pair(path, found->second));
+                    if (!inserted.second) {
+                        // одинаковые пути - узел нельзя выбрать по пути
+                        Alternative ambiguous;
+                        ambiguous.index = 1;
+                        inserted.first->second = ambiguous;
+                    }
+                }
+                for (auto child : *node) {
+                    indexPaths(child, path + separator + name(child->getValue()), name);
+                }
+            }
+
+            template <typename Item, typename Lookup>
+            std::vector<quote_t> price(const std::vector<std::vector<Item>> &configurations, Lookup lookup) const {
+                std::vector<quote_t> quotes(configurations.size());
+                size_t chunks = (configurations.size() + chunkSize - 1) / chunkSize;
+                pool.run(chunks, [&] (size_t chunk) {
+                    size_t begin = chunk * chunkSize;
+                    size_t end = std::min(begin + chunkSize, configurations.size());
+                    PriceBatch batch(layout.size());
+                    std::vector<size_t> priced;
+                    std::vector<size_t> choices(layout.size());
+                    for (size_t k = begin; k < end; k++) {
+                        quotes[k].status = resolve(configurations[k], lookup, choices, quotes[k].item);
+                        if (quotes[k].isValid()) {
+                            batch.add(choices);
+                            priced.push_back(k);
+                        }
+                    }
+                    if (priced.empty()) { return; }
+                    std::vector<int64_t> totals(priced.size());
+                    kernel.evaluate(batch, &totals[0]);
+                    for (size_t b = 0; b < priced.size(); b++) {
+                        quotes[priced[b]].price = PriceUnits<Key>::from(totals[b]);
+                    }
+                });
+                return quotes;
+            }
+
+            /**
+             * Переводит конфигурацию в индексы альтернатив по разрядам
+             * и проверяет её; индексы неактивных разрядов - нулевые.
+             */
+            template <typename Item, typename Lookup>
+            QuoteStatus resolve(const std::vector<Item> &configuration, Lookup &lookup,
+                                std::vector<size_t> &choices, size_t &item) const
+            {
+                const size_t unset = layout_t::npos;
+                std::fill(choices.begin(), choices.end(), unset);
+                for (item = 0; item < configuration.size(); item++) {
+                    Alternative alternative = lookup(configuration[item]);
+                    if (alternative.isAmbiguous()) { return QuoteStatus::AmbiguousNode; }
+                    if (alternative.slot == layout_t::npos) { return QuoteStatus::UnknownNode; }
+                    size_t &choice = choices[alternative.slot];
+                    if (choice != unset && choice != alternative.index) { return QuoteStatus::Conflict; }
+                    choice = alternative.index;
+                }
+                // разряды упорядочены от охватывающих к вложенным
+                std::vector<bool> active(choices.size());
+                for (size_t slot = 0; slot < choices.size(); slot++) {
+                    size_t parent = layout.parent(slot);
+                    active[slot] = parent == layout_t::npos ||
+                        (active[parent] && choices[parent] == layout.branch(slot));
+                    if (active[slot] && choices[slot] == unset) { return QuoteStatus::Incomplete; }
+                    if (!active[slot]) {
+                        if (choices[slot] != unset) { return QuoteStatus::Unreachable; }
+                        choices[slot] = 0;
+                    }
+                }
+                return QuoteStatus::Ok;
+            }
+
+            layout_t layout;
+            PriceKernel<Key, Value> kernel;
+            char separator;
+            mutable WorkStealingPool pool;
+            std::unordered_map<const node_t *, Alternative> alternatives;
+            std::unordered_map<std::string, Alternative> paths;
+        };
+
+        template <typename Key, typename Value>
+        const size_t BatchPricing<Key, Value>::chunkSize;
+    }
+}
@@ -0,0 +1,251 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+#include "PriceBounds.hpp"
+#include "RuleSet.hpp"
+#include "SlotWalker.hpp"
+#include "SolutionView.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /** Решение с суммарным баллом его компонентов. */
+        template <typename Key, typename Value>
+        struct ScoredSolution {
+            ScoredSolution(SolutionView<Key, Value> solution, int64_t score):
+                solution(std::move(solution)), score(score) {}
+
+            Key price() const { return solution.totalPrice(); }
+
+            SolutionView<Key, Value> solution;
+            int64_t score;
+        };
+
+        /**
+         * Поиск count решений с наибольшим суммарным баллом, стоимость
+         * которых не превышает бюджет (задача о рюкзаке на И-ИЛИ дереве),
+         * с учётом зафиксированных узлов и, если заданы, правил совместимости.
+         * Балл компонента задаётся функцией от содержимого узла и суммируется
+         * по всем узлам решения; баллы целые, поэтому границы точные.
+         * Разряды выбора перебираются SlotWalker, как
+         * в ClosestPriceSearch; для каждой альтернативы известны наименьшая
+         * стоимость (PriceBounds) и наибольший балл её продолжений,
+         * и альтернатива отсекается вместе со всем поддеревом, если
+         * её продолжения не укладываются в бюджет или не могут оказаться
+         * лучше худшего из уже найденных count решений.
+         * Решения упорядочены по убыванию балла, затем по возрастанию
+         * стоимости, затем как при переборе SolutionIterator.
+         */
+        template <typename Key, typename Value>
+        class BestValueSearch {
+        public:
+            typedef AndOrTree<Key, Value> tree_t;
+            typedef Node<Key, Value> node_t;
+            typedef ChoiceLayout<Key, Value> layout_t;
+            typedef SolutionView<Key, Value> view_t;
+            typedef RuleSet<Key, Value> rules_t;
+            typedef ScoredSolution<Key, Value> solution_t;
+            typedef std::function<int64_t(const Value &)> score_t;
+
+            BestValueSearch(const tree_t &source, score_t score):
+                layout(std::make_shared<layout_t>(source.getRoot())),
+                walker(layout),
+                score(std::move(score))
+            {
+                prepare();
+            }
+
+            BestValueSearch(const tree_t &source, const rules_t &rules, score_t score):
+                layout(std::make_shared<layout_t>(source.getRoot())),
+                rules(std::make_shared<CompiledRules<Key, Value>>(rules, *layout)),
+                walker(layout),
+                score(std::move(score))
+            {
+                prepare();
+            }
+
+            /**
+             * Возвращает не более count решений со стоимостью не больше budget
+             * и наибольшим баллом в порядке убывания балла.
+             */
+            std::vector<solution_t> find(const Key &budget, size_t count) {
+                this->budget = budget;
+                best.reset(count);
+                if (layout->root() && count > 0 && !(budget < lower[0]) &&
+                    !(rules && rules->isAlwaysViolated()))
+                {
+                    walker.walk(*this, rules.get());
+                }
+                std::vector<Candidate> found = best.take();
+                std::vector<solution_t> result;
+                result.reserve(found.size());
+                for (auto &candidate : found) {
+                    result.push_back(solution_t(view_t(layout, std::move(candidate.choices), candidate.price), candidate.score));
+                }
+                return result;
+            }
+
+        private:
+            friend class SlotWalker<Key, Value>;
+
+            struct Candidate {
+                Candidate(int64_t score, const Key &price, const std::vector<size_t> &choices):
+                    score(score), price(price), sequence(0), choices(choices) {}
+
+                /** Порядок кандидатов: по баллу, стоимости, затем по порядку перебора. */
+                bool isBetterThan(const Candidate &other) const {
+                    if (score != other.score) { return score > other.score; }
+                    if (price < other.price) { return true; }
+                    if (other.price < price) { return false; }
+                    return sequence < other.sequence;
+                }
+
+                int64_t score;
+                Key price;
+                size_t sequence;
+                std::vector<size_t> choices;
+            };
+
+            void prepare() {
+                const node_t *root = layout->root();
+                PriceBounds<Key, Value> bounds(root);
+                std::unordered_map<const node_t *, int64_t> maxScores;
+                if (root) { computeMaxScore(root, maxScores); }
+
+                size_t slots = layout->size();
+                slotPrices.resize(slots);
+                slotScores.resize(slots);
+                for (size_t slot = 0; slot < slots; slot++) {
+                    const node_t *node = layout->node(slot);
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        childPrices.push_back(bounds.of(node->child(i)).min);
+                        childScores.push_back(maxScores[node->child(i)]);
+                    }
+                    slotPrices[slot] = bounds.of(node).min - node->ownKey();
+                    slotScores[slot] = maxScores[node] - score(node->getValue());
+                }
+                lower.resize(slots + 1);
+                upper.resize(slots + 1);
+                if (root) {
+                    lower[0] = bounds.of(root).min;
+                    upper[0] = maxScores[root];
+                }
+            }
+
+            /** Наибольший балл решений поддерева с учётом зафиксированных узлов. */
+            int64_t computeMaxScore(const node_t *node, std::unordered_map<const node_t *, int64_t> &maxScores) const {
+                int64_t result = 0;
+                if (hasChoice(node)) {
+                    size_t fixedIndex = fixedChildIndex(node);
+                    bool first = true;
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        int64_t child = computeMaxScore(node->child(i), maxScores);
+                        if (fixedIndex != node->childCount() && fixedIndex != i) { continue; }
+                        if (first || child > result) { result = child; }
+                        first = false;
+                    }
+                } else {
+                    for (auto child : *node) {
+                        result += computeMaxScore(child, maxScores);
+                    }
+                }
+                result += score(node->getValue());
+                maxScores[node] = result;
+                return result;
+            }
+
+            /**
+             * Рассчитывает наименьшую стоимость и наибольший балл после
+             * выбора альтернативы index в разряде slot.
+             */
+            bool enter(size_t slot, size_t index) {
+                size_t child = walker.offset(slot) + index;
+                Key minPrice = lower[slot] - slotPrices[slot] + childPrices[child];
+                int64_t maxScore = upper[slot] - slotScores[slot] + childScores[child];
+                if (budget < minPrice || !canImprove(maxScore, minPrice)) { return false; }
+                lower[slot + 1] = minPrice;
+                upper[slot + 1] = maxScore;
+                return true;
+            }
+
+            void skip(size_t slot, size_t end) {
+                lower[end] = lower[slot];
+                upper[end] = upper[slot];
+            }
+
+            void complete() {
+                offer(upper.back(), lower.back());
+            }
+
+            /**
+             * Значение "может ли решение с баллом не больше maxScore
+             * и стоимостью не меньше minPrice войти в результат?"
+             * Продолжения перебираются в порядке перебора, поэтому при равных
+             * балле и стоимости побеждает уже найденное решение.
+             */
+            bool canImprove(int64_t maxScore, const Key &minPrice) const {
+                if (!best.isFull()) { return true; }
+                const Candidate &worst = best.worst();
+                return maxScore > worst.score || (maxScore == worst.score && minPrice < worst.price);
+            }
+
+            void offer(int64_t score, const Key &price) {
+                if (!canImprove(score, price)) { return; }
+                best.push(Candidate(score, price, walker.choiceIndices()));
+            }
+
+            std::shared_ptr<const layout_t> layout;
+            std::shared_ptr<const CompiledRules<Key, Value>> rules;
+            SlotWalker<Key, Value> walker;
+            score_t score;
+
+            /** Наименьшие стоимости и наибольшие баллы детей всех разрядов (см. SlotWalker::offset()). */
+            std::vector<Key> childPrices;
+            std::vector<int64_t> childScores;
+            /** Наименьшая стоимость и наибольший балл допустимых альтернатив разряда. */
+            std::vector<Key> slotPrices;
+            std::vector<int64_t> slotScores;
+
+            Key budget;
+            /** Лучшие найденные решения. */
+            BestCandidates<Candidate> best;
+
+            /** Наименьшая стоимость и наибольший балл решений до выбора в разряде slot. */
+            std::vector<Key> lower;
+            std::vector<int64_t> upper;
+        };
+
+        /**
+         * Возвращает не более count решений дерева source со стоимостью
+         * не больше budget и наибольшим суммарным баллом score.
+         * @see BestValueSearch
+         */
+        template <typename Key, typename Value>
+        std::vector<ScoredSolution<Key, Value>> bestValueSolutions(
+            const AndOrTree<Key, Value> &source, std::function<int64_t(const Value &)> score,
+            const Key &budget, size_t count)
+        {
+            return BestValueSearch<Key, Value>(source, std::move(score)).find(budget, count);
+        }
+
+        /** Поиск решений с наибольшим баллом, удовлетворяющих правилам rules. */
+        template <typename Key, typename Value>
+        std::vector<ScoredSolution<Key, Value>> bestValueSolutions(
+            const AndOrTree<Key, Value> &source, const RuleSet<Key, Value> &rules,
+            std::function<int64_t(const Value &)> score, const Key &budget, size_t count)
+        {
+            return BestValueSearch<Key, Value>(source, rules, std::move(score)).find(budget, count);
+        }
+    }
+}
@@ -0,0 +1,228 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+#include "SolutionIterator.hpp"
+#include "PriceBounds.hpp"
+#include "RuleSet.hpp"
+#include "SlotWalker.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /**
+         * Итератор решений, стоимость которых попадает в заданное окно [min, max].
+         * Перебирает разряды выбора SlotWalker (т.е. решения выдаются
+         * в том же порядке, что и у SolutionIterator) и отсекает альтернативу
+         * вместе со всем её поддеревом, если диапазон стоимостей возможных
+         * продолжений не пересекается с окном.
+         * Границы диапазона поддерживаются инкрементально: выбор альтернативы
+         * меняет их на разность между границами альтернативы и границами
+         * всех допустимых альтернатив узла, поэтому шаг перебора не требует
+         * обхода дерева.
+         * Если заданы правила совместимости (RuleSet), альтернатива
+         * отсекается также при нарушении правил, зависящих от её разряда,
+         * т.е. недопустимые решения не перебираются.
+         * Дерево решения (currentSolution) обновляется только для
+         * выдаваемых решений.
+         * Наследование защищённое: переход по номеру и контрольные точки
+         * SolutionIterator (seek, checkpoint, restore) не учитывают окно,
+         * правила и состояние поиска.
+         */
+        template <typename Key, typename Value>
+        class BranchAndBoundIterator : protected SolutionIterator<Key, Value> {
+        public:
+            typedef SolutionIterator<Key, Value> base_t;
+            typedef typename base_t::tree_t tree_t;
+            typedef typename base_t::node_t node_t;
+            typedef typename base_t::solution_tree_t solution_tree_t;
+            typedef typename base_t::layout_t layout_t;
+            typedef typename base_t::view_t view_t;
+            typedef PriceRange<Key> window_t;
+            typedef RuleSet<Key, Value> rules_t;
+
+            using base_t::solutionCount;
+            using base_t::choiceLayout;
+            using base_t::currentSolution;
+            using base_t::currentView;
+
+            BranchAndBoundIterator(const tree_t &source, const window_t &window):
+                base_t(source),
+                window(window),
+                walker(this->layout)
+            {
+                start();
+            }
+
+            /** Перебор решений в окне, удовлетворяющих правилам rules. */
+            BranchAndBoundIterator(const tree_t &source, const window_t &window, const rules_t &rules):
+                base_t(source),
+                window(window),
+                rules(std::make_shared<CompiledRules<Key, Value>>(rules, *this->layout)),
+                walker(this->layout)
+            {
+                start();
+            }
+
+            /** Перебор всех решений, удовлетворяющих правилам rules. */
+            BranchAndBoundIterator(const tree_t &source, const rules_t &rules):
+                base_t(source),
+                window(wholeRange(source)),
+                rules(std::make_shared<CompiledRules<Key, Value>>(rules, *this->layout)),
+                walker(this->layout)
+            {
+                start();
+            }
+
+            /**
+             * Значение "есть ли хотя бы одно решение в окне?"
+             * В отличие от solutionCount(), который возвращает мощность
+             * всего множества решений без учёта окна.
+             */
+            bool hasSolution() {
+                return found;
+            }
+
+            bool nextSolution() {
+                found = found && search(true);
+                if (found) { applyChoices(); }
+                return found;
+            }
+
+            /** Возвращает стоимость текущего решения. */
+            const Key & currentPrice() const {
+                return lower.back();
+            }
+
+            /** Возвращает окно стоимостей. */
+            const window_t & priceWindow() const {
+                return window;
+            }
+
+        private:
+            static window_t wholeRange(const tree_t &source) {
+                if (!source.getRoot()) { return window_t(); }
+                return PriceBounds<Key, Value>(source.getRoot()).of(source.getRoot());
+            }
+
+            void start() {
+                prepare();
+                found = search(false);
+                if (found) { applyChoices(); }
+            }
+
+            void prepare() {
+                const auto &layout = *this->layout;
+                const node_t *root = this->source.getRoot();
+                PriceBounds<Key, Value> bounds(root);
+
+                size_t count = layout.size();
+                slotRanges.resize(count);
+                for (size_t slot = 0; slot < count; slot++) {
+                    const node_t *node = layout.node(slot);
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        childRanges.push_back(bounds.of(node->child(i)));
+                    }
+                    // диапазон всех допустимых альтернатив без собственного ключа узла
+                    const window_t &range = bounds.of(node);
+                    slotRanges[slot] = window_t(range.min - node->ownKey(), range.max - node->ownKey());
+                }
+
+                lower.resize(count + 1);
+                upper.resize(count + 1);
+                if (root) {
+                    lower[0] = bounds.of(root).min;
+                    upper[0] = bounds.of(root).max;
+                }
+            }
+
+            /**
+             * Ищет следующее решение в окне.
+             * @param resume false - поиск первого решения,
+             *     true - продолжение поиска после текущего решения
+             */
+            bool search(bool resume) {
+                if (!this->source.getRoot()) { return false; }
+                if (rules && rules->isAlwaysViolated()) { return false; }
+                size_t count = walker.size();
+                size_t slot = resume ? count : 0;
+                bool forward = !resume;
+                if (forward && !window.intersects(window_t(lower[0], upper[0]))) { return false; }
+                for (;;) {
+                    if (forward) {
+                        if (slot == count) { return true; }
+                        if (walker.activate(slot)) {
+                            forward = tryChoice(slot, walker.firstAlternative(slot));
+                        } else {
+                            lower[slot + 1] = lower[slot];
+                            upper[slot + 1] = upper[slot];
+                        }
+                        if (forward) { slot++; }
+                    } else {
+                        if (slot == 0) { return false; }
+                        slot--;
+                        if (walker.wasActive(slot) && walker.isFree(slot)) {
+                            forward = tryChoice(slot, walker.choice(slot) + 1);
+                            if (forward) { slot++; }
+                        }
+                    }
+                }
+            }
+
+            /**
+             * Выбирает в разряде slot первую альтернативу, начиная с from,
+             * диапазон стоимостей которой пересекается с окном
+             * и выбор которой не нарушает правил.
+             */
+            bool tryChoice(size_t slot, size_t from) {
+                from = std::max(from, walker.firstAlternative(slot));
+                const window_t &slotRange = slotRanges[slot];
+                for (size_t i = from; i < walker.endAlternative(slot); i++) {
+                    const window_t &childRange = childRanges[walker.offset(slot) + i];
+                    Key min = lower[slot] - slotRange.min + childRange.min;
+                    Key max = upper[slot] - slotRange.max + childRange.max;
+                    if (!window.intersects(window_t(min, max))) { continue; }
+                    walker.choose(slot, i);
+                    if (rules && !rules->isConsistent(walker.choiceIndices(), slot)) { continue; }
+                    lower[slot + 1] = min;
+                    upper[slot + 1] = max;
+                    return true;
+                }
+                return false;
+            }
+
+            /** Переносит выбранные индексы в дерево решения. */
+            void applyChoices() {
+                for (size_t slot = walker.size(); slot-- > 0;) {
+                    auto node = this->choiceNodes[slot];
+                    auto &choice = node->getValue();
+                    if (choice.index != walker.choice(slot)) {
+                        choice.index = walker.choice(slot);
+                        this->solution.recomputeKey(node);
+                    }
+                }
+            }
+
+            window_t window;
+            std::shared_ptr<const CompiledRules<Key, Value>> rules;
+            /** Выбранные индексы разрядов и разряды текущего решения. */
+            SlotWalker<Key, Value> walker;
+            bool found;
+
+            /** Диапазоны стоимостей детей всех разрядов (см. SlotWalker::offset()). */
+            std::vector<window_t> childRanges;
+            /** Диапазоны стоимостей допустимых альтернатив разряда. */
+            std::vector<window_t> slotRanges;
+
+            /**
+             * Границы стоимости решений до выбора в разряде slot
+             * (lower[slot], upper[slot]); последний элемент - после всех выборов.
+             */
+            std::vector<Key> lower;
+            std::vector<Key> upper;
+        };
+    }
+}
@@ -0,0 +1,124 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /**
+         * Состояние перебора решений, достаточное для его продолжения
+         * с того же места в другом процессе (см. SolutionIterator::checkpoint()).
+         * Кроме индексов выбранных альтернатив хранит хеш модели
+         * (структура дерева и ключи узлов) и отпечаток зафиксированных
+         * узлов, чтобы при восстановлении убедиться, что перебирается
+         * то же самое множество решений.
+         */
+        struct Checkpoint {
+            Checkpoint(): modelHash(0), fixedFingerprint(0) {}
+
+            /** Хеш модели (см. modelHash()). */
+            uint64_t modelHash;
+            /** Отпечаток зафиксированных узлов (см. fixedFingerprint()). */
+            uint64_t fixedFingerprint;
+            /** Индексы выбранных альтернатив по разрядам ChoiceLayout. */
+            std::vector<size_t> choices;
+        };
+
+        namespace internal {
+            /** Хеш FNV-1a (64 бита): начальное значение и шаг. */
+            const uint64_t fnvOffset = 14695981039346656037ULL;
+            const uint64_t fnvPrime = 1099511628211ULL;
+
+            inline uint64_t fnv(uint64_t hash, const void *data, size_t size) {
+                const unsigned char *bytes = static_cast<const unsigned char *>(data);
+                for (size_t i = 0; i < size; i++) {
+                    hash = (hash ^ bytes[i]) * fnvPrime;
+                }
+                return hash;
+            }
+
+            inline uint64_t fnv(uint64_t hash, uint64_t value) {
+                // побайтно от младшего, чтобы хеш не зависел от платформы
+                for (int i = 0; i < 8; i++) {
+                    hash = (hash ^ ((value >> (8 * i)) & 0xFF)) * fnvPrime;
+                }
+                return hash;
+            }
+
+            template <typename Key, typename Value>
+            uint64_t hashNode(uint64_t hash, const Node<Key, Value> *node) {
+                std::ostringstream key;
+                std::ostream &os = key;
+                os << node->ownKey();
+                std::string text = key.str();
+                hash = fnv(hash, (uint64_t)node->getKind());
+                hash = fnv(hash, text.data(), text.size());
+                hash = fnv(hash, (uint64_t)node->childCount());
+                for (auto child : *node) {
+                    hash = hashNode(hash, child);
+                }
+                return hash;
+            }
+        }
+
+        /**
+         * Возвращает хеш модели: типы узлов, их ключи и структура дерева.
+         * Содержимое узлов (Value) и зафиксированные узлы не учитываются.
+         */
+        template <typename Key, typename Value>
+        uint64_t modelHash(const AndOrTree<Key, Value> &tree) {
+            uint64_t hash = internal::fnvOffset;
+            if (tree.getRoot()) { hash = internal::hashNode(hash, tree.getRoot()); }
+            return hash;
+        }
+
+        /** Возвращает отпечаток зафиксированных узлов: индексы зафиксированных детей разрядов. */
+        template <typename Key, typename Value>
+        uint64_t fixedFingerprint(const ChoiceLayout<Key, Value> &layout) {
+            uint64_t hash = internal::fnvOffset;
+            for (size_t slot = 0; slot < layout.size(); slot++) {
+                hash = internal::fnv(hash, (uint64_t)fixedChildIndex(layout.node(slot)));
+            }
+            return hash;
+        }
+
+        /**
+         * Записывает состояние перебора в текстовом виде:
+         * "checkpoint 1 <modelHash> <fixedFingerprint> <N> <индексы...>".
+         */
+        inline std::ostream & operator<<(std::ostream &os, const Checkpoint &checkpoint) {
+            os << "checkpoint 1 " << std::hex << checkpoint.modelHash << ' '
+               << checkpoint.fixedFingerprint << std::dec << ' ' << checkpoint.choices.size();
+            for (size_t choice : checkpoint.choices) { os << ' ' << choice; }
+            return os << '\n';
+        }
+
+        /** Читает состояние перебора; при ошибке формата устанавливает failbit. */
+        inline std::istream & operator>>(std::istream &is, Checkpoint &checkpoint) {
+            std::string tag;
+            int version = 0;
+            size_t count = 0;
+            if (!(is >> tag >> version) || tag != "checkpoint" || version != 1) {
+                is.setstate(std::ios::failbit);
+                return is;
+            }
+            Checkpoint result;
+            is >> std::hex >> result.modelHash >> result.fixedFingerprint >> std::dec >> count;
+            for (size_t i = 0; is && i < count; i++) {
+                size_t choice;
+                if (is >> choice) { result.choices.push_back(choice); }
+            }
+            if (is) { checkpoint = result; }
+            return is;
+        }
+    }
+}
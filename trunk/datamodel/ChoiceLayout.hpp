@@ -0,0 +1,147 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <unordered_map>
+#include <vector>
+
+#include "AndOrTree.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /**
+         * Значение "возможен ли выбор альтернативы среди детей узла?"
+         * (т.е. узел имеет тип ИЛИ и у него есть дети).
+         * Подходит как для узлов исходного дерева, так и для узлов дерева решения.
+         */
+        template <typename NodePtr>
+        bool hasChoice(NodePtr node) {
+            return node->getKind() == NodeKind::OR && !node->isLeaf();
+        }
+
+        /**
+         * Возвращает индекс зафиксированного (getValue().isFixed())
+         * ребёнка узла, либо node->childCount(), если такого нет.
+         */
+        template <typename Key, typename Value>
+        size_t fixedChildIndex(const Node<Key, Value> *node) {
+            for (size_t i = 0; i < node->childCount(); i++) {
+                if (node->child(i)->getValue().isFixed()) { return i; }
+            }
+            return node->childCount();
+        }
+
+        /**
+         * Собирает узлы выбора (см. hasChoice) поддерева в порядке
+         * убывания значимости разряда при переборе SolutionIterator:
+         * ИЛИ-узел значимее своих потомков, а из детей И-узла
+         * наиболее значим последний. Т.е. это обход Родитель-Дети,
+         * в котором дети посещаются в обратном порядке.
+         */
+        template <typename NodePtr>
+        void collectChoiceNodes(NodePtr node, std::vector<NodePtr> &nodes) {
+            if (hasChoice(node)) { nodes.push_back(node); }
+            for (size_t i = node->childCount(); i-- > 0;) {
+                collectChoiceNodes(node->child(i), nodes);
+            }
+        }
+
+        /**
+         * Разметка разрядов выбора исходного дерева: каждому узлу выбора
+         * сопоставляется номер разряда (slot) в порядке collectChoiceNodes.
+         * Для каждого разряда хранится ближайший охватывающий разряд (parent)
+         * и индекс ребёнка этого разряда, в поддереве которого он находится
+         * (branch); разряды поддерева узла занимают непрерывный диапазон
+         * (slot, end(slot)).
+         * Разметка зависит только от структуры дерева, но не от
+         * зафиксированных узлов, и должна строиться заново при
+         * изменении структуры.
+         */
+        template <typename Key, typename Value>
+        class ChoiceLayout {
+        public:
+            typedef Node<Key, Value> node_t;
+
+            static const size_t npos = (size_t)-1;
+
+            explicit ChoiceLayout(const node_t *root): rootNode(root) {
+                if (root) {
+                    mark(root, npos, 0);
+                    for (size_t slot = 0; slot < nodes.size(); slot++) {
+                        slots[nodes[slot]] = slot;
+                    }
+                }
+            }
+
+            /** Возвращает корень исходного дерева. */
+            const node_t * root() const { return rootNode; }
+
+            /** Возвращает количество разрядов выбора. */
+            size_t size() const { return nodes.size(); }
+
+            /** Возвращает узел исходного дерева, соответствующий разряду. */
+            const node_t * node(size_t slot) const { return nodes.at(slot); }
+
+            /** Возвращает разряд узла, либо npos, если узел не является узлом выбора. */
+            size_t slotOf(const node_t *node) const {
+                auto it = slots.find(node);
+                return it == slots.end() ? npos : it->second;
+            }
+
+            /** Возвращает ближайший охватывающий разряд, либо npos для верхних разрядов. */
+            size_t parent(size_t slot) const { return parents.at(slot); }
+
+            /**
+             * Возвращает индекс ребёнка узла parent(slot),
+             * в поддереве которого находится узел разряда slot.
+             */
+            size_t branch(size_t slot) const { return branches.at(slot); }
+
+            /** Возвращает разряд, следующий за всеми разрядами поддерева узла slot. */
+            size_t end(size_t slot) const { return ends.at(slot); }
+
+            /**
+             * Значение "участвует ли разряд в решении?" для вектора
+             * выбранных индексов choices (по одному на разряд).
+             */
+            bool isActive(const std::vector<size_t> &choices, size_t slot) const {
+                for (size_t p = parents.at(slot); p != npos; slot = p, p = parents.at(p)) {
+                    if (choices.at(p) != branches.at(slot)) { return false; }
+                }
+                return true;
+            }
+
+        private:
+            /**
+             * Нумерует разряды поддерева узла node в порядке collectChoiceNodes.
+             * @param parent ближайший охватывающий разряд
+             * @param branch индекс ребёнка parent, содержащего node
+             */
+            void mark(const node_t *node, size_t parent, size_t branch) {
+                if (hasChoice(node)) {
+                    size_t slot = nodes.size();
+                    nodes.push_back(node);
+                    parents.push_back(parent);
+                    branches.push_back(branch);
+                    ends.push_back(0);
+                    for (size_t i = node->childCount(); i-- > 0;) {
+                        mark(node->child(i), slot, i);
+                    }
+                    ends[slot] = nodes.size();
+                } else {
+                    for (size_t i = node->childCount(); i-- > 0;) {
+                        mark(node->child(i), parent, branch);
+                    }
+                }
+            }
+
+            const node_t *rootNode;
+            std::vector<const node_t *> nodes;
+            std::unordered_map<const node_t *, size_t> slots;
+            std::vector<size_t> parents;
+            std::vector<size_t> branches;
+            std::vector<size_t> ends;
+        };
+    }
+}
@@ -0,0 +1,194 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+#include "PriceBounds.hpp"
+#include "RuleSet.hpp"
+#include "SlotWalker.hpp"
+#include "SolutionView.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /**
+         * Поиск count решений, стоимость которых ближе всего к target
+         * ("что-нибудь около 4.5 млн"), с учётом зафиксированных узлов
+         * и, если заданы, правил совместимости.
+         * Разряды выбора перебираются SlotWalker, как
+         * в BranchAndBoundIterator; для каждой альтернативы известен
+         * диапазон стоимостей её продолжений (PriceBounds), и альтернатива
+         * отсекается вместе со всем поддеревом, если расстояние от target
+         * до этого диапазона не меньше расстояния у худшего из уже
+         * найденных count решений. Решения с одинаковым расстоянием
+         * упорядочены как при переборе SolutionIterator, т.е. результат
+         * не зависит от способа поиска.
+         */
+        template <typename Key, typename Value>
+        class ClosestPriceSearch {
+        public:
+            typedef AndOrTree<Key, Value> tree_t;
+            typedef Node<Key, Value> node_t;
+            typedef ChoiceLayout<Key, Value> layout_t;
+            typedef SolutionView<Key, Value> view_t;
+            typedef PriceRange<Key> range_t;
+            typedef RuleSet<Key, Value> rules_t;
+
+            ClosestPriceSearch(const tree_t &source):
+                layout(std::make_shared<layout_t>(source.getRoot())),
+                walker(layout)
+            {
+                prepare();
+            }
+
+            ClosestPriceSearch(const tree_t &source, const rules_t &rules):
+                layout(std::make_shared<layout_t>(source.getRoot())),
+                rules(std::make_shared<CompiledRules<Key, Value>>(rules, *layout)),
+                walker(layout)
+            {
+                prepare();
+            }
+
+            /**
+             * Возвращает не более count решений, ближайших по стоимости
+             * к target, в порядке возрастания расстояния.
+             */
+            std::vector<view_t> find(const Key &target, size_t count) {
+                this->target = target;
+                best.reset(count);
+                if (layout->root() && count > 0 && !(rules && rules->isAlwaysViolated())) {
+                    walker.walk(*this, rules.get());
+                }
+                std::vector<Candidate> found = best.take();
+                std::vector<view_t> result;
+                result.reserve(found.size());
+                for (auto &candidate : found) {
+                    result.push_back(view_t(layout, std::move(candidate.choices), candidate.price));
+                }
+                return result;
+            }
+
+        private:
+            friend class SlotWalker<Key, Value>;
+
+            struct Candidate {
+                Candidate(const Key &distance, const std::vector<size_t> &choices, const Key &price):
+                    distance(distance), sequence(0), choices(choices), price(price) {}
+
+                /** Порядок кандидатов: по расстоянию, затем по порядку перебора. */
+                bool isBetterThan(const Candidate &other) const {
+                    return distance < other.distance ||
+                        (!(other.distance < distance) && sequence < other.sequence);
+                }
+
+                Key distance;
+                size_t sequence;
+                std::vector<size_t> choices;
+                Key price;
+            };
+
+            void prepare() {
+                const node_t *root = layout->root();
+                PriceBounds<Key, Value> bounds(root);
+                size_t slots = layout->size();
+                slotRanges.resize(slots);
+                for (size_t slot = 0; slot < slots; slot++) {
+                    const node_t *node = layout->node(slot);
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        childRanges.push_back(bounds.of(node->child(i)));
+                    }
+                    const range_t &range = bounds.of(node);
+                    slotRanges[slot] = range_t(range.min - node->ownKey(), range.max - node->ownKey());
+                }
+                lower.resize(slots + 1);
+                upper.resize(slots + 1);
+                if (root) {
+                    lower[0] = bounds.of(root).min;
+                    upper[0] = bounds.of(root).max;
+                }
+            }
+
+            /** Рассчитывает границы стоимости после выбора альтернативы index в разряде slot. */
+            bool enter(size_t slot, size_t index) {
+                const range_t &slotRange = slotRanges[slot];
+                const range_t &childRange = childRanges[walker.offset(slot) + index];
+                Key min = lower[slot] - slotRange.min + childRange.min;
+                Key max = upper[slot] - slotRange.max + childRange.max;
+                if (!canImprove(min, max)) { return false; }
+                lower[slot + 1] = min;
+                upper[slot + 1] = max;
+                return true;
+            }
+
+            void skip(size_t slot, size_t end) {
+                lower[end] = lower[slot];
+                upper[end] = upper[slot];
+            }
+
+            void complete() {
+                offer(lower.back());
+            }
+
+            /**
+             * Значение "может ли решение со стоимостью в [min, max] войти
+             * в результат?" Продолжения перебираются в порядке перебора,
+             * поэтому при равном расстоянии побеждает уже найденное решение.
+             */
+            bool canImprove(const Key &min, const Key &max) const {
+                if (!best.isFull()) { return true; }
+                Key distance = target < min ? min - target : (max < target ? target - max : Key());
+                return distance < best.worst().distance;
+            }
+
+            void offer(const Key &price) {
+                Key distance = target < price ? price - target : target - price;
+                if (best.isFull() && !(distance < best.worst().distance)) { return; }
+                best.push(Candidate(distance, walker.choiceIndices(), price));
+            }
+
+            std::shared_ptr<const layout_t> layout;
+            std::shared_ptr<const CompiledRules<Key, Value>> rules;
+            SlotWalker<Key, Value> walker;
+
+            /** Диапазоны стоимостей детей всех разрядов (см. SlotWalker::offset()). */
+            std::vector<range_t> childRanges;
+            /** Диапазоны стоимостей допустимых альтернатив разряда. */
+            std::vector<range_t> slotRanges;
+
+            Key target;
+            /** Лучшие найденные решения. */
+            BestCandidates<Candidate> best;
+
+            /** Границы стоимости решений до выбора в разряде slot. */
+            std::vector<Key> lower;
+            std::vector<Key> upper;
+        };
+
+        /**
+         * Возвращает не более count решений дерева source, стоимость которых
+         * ближе всего к target, в порядке возрастания расстояния.
+         * @see ClosestPriceSearch
+         */
+        template <typename Key, typename Value>
+        std::vector<SolutionView<Key, Value>> closestSolutions(
+            const AndOrTree<Key, Value> &source, const Key &target, size_t count)
+        {
+            return ClosestPriceSearch<Key, Value>(source).find(target, count);
+        }
+
+        /** Поиск ближайших по стоимости решений, удовлетворяющих правилам rules. */
+        template <typename Key, typename Value>
+        std::vector<SolutionView<Key, Value>> closestSolutions(
+            const AndOrTree<Key, Value> &source, const RuleSet<Key, Value> &rules,
+            const Key &target, size_t count)
+        {
+            return ClosestPriceSearch<Key, Value>(source, rules).find(target, count);
+        }
+    }
+}
@@ -0,0 +1,523 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+#include "PriceBounds.hpp"
+#include "RuleSet.hpp"
+#include "SolutionView.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        template <typename Key, typename Value>
+        class DiagramIterator;
+
+        /**
+         * Множество решений И-ИЛИ дерева в виде упорядоченной диаграммы
+         * решений с разделением узлов (многозначный аналог ZDD).
+         * Переменные диаграммы - разряды выбора ChoiceLayout в порядке
+         * разметки; узел диаграммы проверяет один разряд и для каждой
+         * альтернативы ссылается на диаграмму продолжений. Разряды,
+         * пропущенные на пути, в решение не входят (неактивны),
+         * как пропущенные переменные в ZDD. Одинаковые узлы хранятся
+         * в одном экземпляре, а узел, все ветви которого пусты, заменяется
+         * пустым множеством, поэтому свободное дерево компилируется
+         * в диаграмму не больше числа разрядов.
+         * Стоимость решения - сумма стоимости base и весов выбранных
+         * альтернатив (собственные ключи узлов, ближайший узел выбора
+         * над которыми - данный разряд), поэтому количество решений,
+         * наименьшая и наибольшая стоимость рассчитываются за время,
+         * пропорциональное размеру диаграммы, а не числу решений.
+         * Множества, полученные из одной диаграммы (ограничения по узлам
+         * дерева, правила, пересечение, объединение, разность), делят
+         * общее хранилище узлов и объединяются, не перебирая решений.
+         * Диаграмма - лёгкое значение (хранилище и номер корня); объекты,
+         * полученные из одной диаграммы, нельзя использовать из разных
+         * потоков одновременно. Исходное дерево не должно изменяться,
+         * пока используется диаграмма.
+         */
+        template <typename Key, typename Value>
+        class DecisionDiagram {
+        public:
+            typedef AndOrTree<Key, Value> tree_t;
+            typedef Node<Key, Value> node_t;
+            typedef ChoiceLayout<Key, Value> layout_t;
+            typedef SolutionView<Key, Value> view_t;
+            typedef RuleSet<Key, Value> rules_t;
+            typedef PriceRange<Key> range_t;
+            typedef uint64_t count_t;
+
+            /** Компилирует все решения дерева source с учётом зафиксированных узлов. */
+            explicit DecisionDiagram(const tree_t &source):
+                store(std::make_shared<Store>(source.getRoot())),
+                top(store->compile())
+            {}
+
+            /** Компилирует решения дерева source, удовлетворяющие правилам rules. */
+            DecisionDiagram(const tree_t &source, const rules_t &rules):
+                store(std::make_shared<Store>(source.getRoot())),
+                top(store->compile())
+            {
+                *this = intersect(rules);
+            }
+
+            /** Значение "пусто ли множество решений?" */
+            bool empty() const { return top == emptySet; }
+
+            /** Возвращает количество узлов диаграммы (без терминальных). */
+            size_t size() const {
+                std::vector<bool> visited(store->slots.size(), false);
+                return store->reachable(top, visited);
+            }
+
+            /** Возвращает количество решений. */
+            count_t count() const {
+                std::vector<count_t> memo(store->slots.size(), unknown);
+                return store->count(top, memo);
+            }
+
+            /** Возвращает наименьшую стоимость решения; множество не должно быть пустым. */
+            Key minPrice() const { return extremePrice(false); }
+
+            /** Возвращает наибольшую стоимость решения; множество не должно быть пустым. */
+            Key maxPrice() const { return extremePrice(true); }
+
+            /** Возвращает диапазон стоимостей решений; множество не должно быть пустым. */
+            range_t priceRange() const { return range_t(minPrice(), maxPrice()); }
+
+            /** Возвращает решения, в которые входит узел исходного дерева node. */
+            DecisionDiagram with(const node_t *node) const {
+                auto condition = store->conditionOf(node);
+                if (condition.first == layout_t::npos) { return *this; }
+                std::unordered_map<size_t, size_t> memo;
+                return DecisionDiagram(store, store->restrict(top, condition, true, memo));
+            }
+
+            /** Возвращает решения, в которые не входит узел исходного дерева node. */
+            DecisionDiagram without(const node_t *node) const {
+                auto condition = store->conditionOf(node);
+                if (condition.first == layout_t::npos) { return DecisionDiagram(store, emptySet); }
+                std::unordered_map<size_t, size_t> memo;
+                return DecisionDiagram(store, store->restrict(top, condition, false, memo));
+            }
+
+            /** Возвращает решения, удовлетворяющие правилам rules. */
+            DecisionDiagram intersect(const rules_t &rules) const {
+                DecisionDiagram result = *this;
+                for (auto &rule : rules.rules()) {
+                    DecisionDiagram withFirst = result.with(rule.first);
+                    DecisionDiagram allowed = rule.kind == RuleKind::Requires
+                        ? withFirst.with(rule.second)
+                        : withFirst.without(rule.second);
+                    result = result.without(rule.first) | allowed;
+                }
+                return result;
+            }
+
+            /** Пересечение множеств решений одной диаграммы. */
+            DecisionDiagram operator&(const DecisionDiagram &other) const {
+                return combine(other, Operation::Intersection);
+            }
+
+            /** Объединение множеств решений одной диаграммы. */
+            DecisionDiagram operator|(const DecisionDiagram &other) const {
+                return combine(other, Operation::Union);
+            }
+
+            /** Разность множеств решений одной диаграммы. */
+            DecisionDiagram operator-(const DecisionDiagram &other) const {
+                return combine(other, Operation::Difference);
+            }
+
+            bool operator==(const DecisionDiagram &other) const {
+                assert(store == other.store);
+                return top == other.top;
+            }
+
+            bool operator!=(const DecisionDiagram &other) const { return !(*this == other); }
+
+        private:
+            friend class DiagramIterator<Key, Value>;
+
+            /** Пустое множество и множество из единственного пустого продолжения. */
+            static const size_t emptySet = 0;
+            static const size_t unitSet = 1;
+            static const count_t unknown = (count_t)-1;
+
+            enum class Operation { Intersection, Union, Difference };
+
+            struct EdgeHash {
+                size_t operator()(const std::vector<size_t> &key) const {
+                    uint64_t hash = 14695981039346656037ULL;
+                    for (size_t value : key) {
+                        hash = (hash ^ (uint64_t)value) * 1099511628211ULL;
+                    }
+                    return (size_t)hash;
+                }
+            };
+
+            /** Общее хранилище узлов диаграмм, полученных из одного дерева. */
+            struct Store {
+                explicit Store(const node_t *root):
+                    layout(std::make_shared<layout_t>(root)),
+                    base()
+                {
+                    size_t slotCount = layout->size();
+                    offsets.assign(slotCount + 1, 0);
+                    for (size_t slot = 0; slot < slotCount; slot++) {
+                        offsets[slot + 1] = offsets[slot] + layout->node(slot)->childCount();
+                    }
+                    weights.assign(offsets[slotCount], Key());
+                    nested.resize(offsets[slotCount]);
+                    for (size_t slot = 0; slot < slotCount; slot++) {
+                        size_t parent = layout->parent(slot);
+                        if (parent == layout_t::npos) {
+                            topSlots.push_back(slot);
+                        } else {
+                            nested[offsets[parent] + layout->branch(slot)].push_back(slot);
+                        }
+                    }
+                    if (root) { distribute(root, layout_t::npos, 0); }
+                    // терминальные узлы: разряд за последним, ветвей нет
+                    for (size_t i = 0; i < 2; i++) {
+                        slots.push_back(slotCount);
+                        edgeBegin.push_back(0);
+                    }
+                }
+
+                /** Распределяет собственные ключи узлов по весам альтернатив. */
+                void distribute(const node_t *node, size_t slot, size_t branch) {
+                    if (slot == layout_t::npos) {
+                        base = base + node->ownKey();
+                    } else {
+                        weights[offsets[slot] + branch] = weights[offsets[slot] + branch] + node->ownKey();
+                    }
+                    conditions[node] = std::make_pair(slot, branch);
+                    bool choice = hasChoice(node);
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        if (choice) {
+                            distribute(node->child(i), layout->slotOf(node), i);
+                        } else {
+                            distribute(node->child(i), slot, branch);
+                        }
+                    }
+                }
+
+                size_t compile() {
+                    if (!layout->root()) { return emptySet; }
+                    return compileChain(topSlots, unitSet);
+                }
+
+                /** Диаграмма выбора в разрядах chain по порядку, за которыми следует next. */
+                size_t compileChain(const std::vector<size_t> &chain, size_t next) {
+                    for (size_t i = chain.size(); i-- > 0;) {
+                        next = compileSlot(chain[i], next);
+                    }
+                    return next;
+                }
+
+                size_t compileSlot(size_t slot, size_t next) {
+                    if (next == emptySet) { return emptySet; }
+                    const node_t *node = layout->node(slot);
+                    size_t fixed = fixedChildIndex(node);
+                    std::vector<size_t> targets(node->childCount(), emptySet);
+                    for (size_t i = 0; i < targets.size(); i++) {
+                        if (fixed == targets.size() || fixed == i) {
+                            targets[i] = compileChain(nested[offsets[slot] + i], next);
+                        }
+                    }
+                    return make(slot, targets);
+                }
+
+                /** Возвращает единственный экземпляр узла разряда slot с ветвями targets. */
+                size_t make(size_t slot, const std::vector<size_t> &targets) {
+                    bool allEmpty = true;
+                    for (size_t target : targets) {
+                        if (target != emptySet) { allEmpty = false; break; }
+                    }
+                    if (allEmpty) { return emptySet; }
+
+                    std::vector<size_t> key;
+                    key.reserve(targets.size() + 1);
+                    key.push_back(slot);
+                    key.insert(key.end(), targets.begin(), targets.end());
+                    auto found = unique.find(key);
+                    if (found != unique.end()) { return found->second; }
+
+                    size_t id = slots.size();
+                    slots.push_back(slot);
+                    edgeBegin.push_back(edges.size());
+                    edges.insert(edges.end(), targets.begin(), targets.end());
+                    unique.insert(std::make_pair(std::move(key), id));
+                    return id;
+                }
+
+                size_t edgeCount(size_t id) const {
+                    return id <= unitSet ? 0 : offsets[slots[id] + 1] - offsets[slots[id]];
+                }
+
+                size_t target(size_t id, size_t i) const { return edges[edgeBegin[id] + i]; }
+
+                Key weight(size_t id, size_t i) const { return weights[offsets[slots[id]] + i]; }
+
+                /**
+                 * Возвращает условие "разряд - ветвь", при котором узел node
+                 * входит в решение (разряд layout_t::npos - входит всегда).
+                 */
+                std::pair<size_t, size_t> conditionOf(const node_t *node) const {
+                    auto found = conditions.find(node);
+                    assert(found != conditions.end());
+                    return found->second;
+                }
+
+                size_t reachable(size_t id, std::vector<bool> &visited) const {
+                    if (id <= unitSet || visited[id]) { return 0; }
+                    visited[id] = true;
+                    size_t total = 1;
+                    for (size_t i = 0; i < edgeCount(id); i++) {
+                        total += reachable(target(id, i), visited);
+                    }
+                    return total;
+                }
+
+                count_t count(size_t id, std::vector<count_t> &memo) const {
+                    if (id <= unitSet) { return id; }
+                    if (memo[id] != unknown) { return memo[id]; }
+                    count_t total = 0;
+                    for (size_t i = 0; i < edgeCount(id); i++) {
+                        total += count(target(id, i), memo);
+                    }
+                    return memo[id] = total;
+                }
+
+                /** Наименьшая (наибольшая) сумма весов от узла id до конца; id не пуст. */
+                Key extreme(size_t id, bool maximum, std::vector<Key> &memo, std::vector<bool> &known) const {
+                    if (id == unitSet) { return Key(); }
+                    if (known[id]) { return memo[id]; }
+                    bool first = true;
+                    Key best = Key();
+                    for (size_t i = 0; i < edgeCount(id); i++) {
+                        size_t next = target(id, i);
+                        if (next == emptySet) { continue; }
+                        Key price = weight(id, i) + extreme(next, maximum, memo, known);
+                        if (first || (maximum ? best < price : price < best)) {
+                            best = price;
+                            first = false;
+                        }
+                    }
+                    known[id] = true;
+                    return memo[id] = best;
+                }
+
+                /**
+                 * Оставляет решения, в которых в разряде condition.first
+                 * выбрана (keep) или не выбрана (!keep) ветвь condition.second.
+                 * Разряды на пути возрастают, поэтому узел более позднего
+                 * разряда означает, что разряд условия неактивен.
+                 */
+                size_t restrict(size_t id, const std::pair<size_t, size_t> &condition, bool keep,
+                                std::unordered_map<size_t, size_t> &memo)
+                {
+                    if (id == emptySet) { return emptySet; }
+                    size_t slot = slots[id];
+                    if (slot > condition.first) { return keep ? emptySet : id; }
+                    auto found = memo.find(id);
+                    if (found != memo.end()) { return found->second; }
+
+                    std::vector<size_t> targets(edgeCount(id));
+                    for (size_t i = 0; i < targets.size(); i++) {
+                        size_t next = target(id, i);
+                        if (slot < condition.first) {
+                            targets[i] = restrict(next, condition, keep, memo);
+                        } else {
+                            targets[i] = (i == condition.second) == keep ? next : emptySet;
+                        }
+                    }
+                    size_t result = make(slot, targets);
+                    memo[id] = result;
+                    return result;
+                }
+
+                /**
+                 * Применяет операцию к множествам a и b. Активность разряда
+                 * определяется выбором в предшествующих разрядах, поэтому
+                 * непустые диаграммы, достигнутые по одному пути, проверяют
+                 * один и тот же разряд.
+                 */
+                size_t apply(Operation operation, size_t a, size_t b,
+                             std::unordered_map<uint64_t, size_t> &memo)
+                {
+                    switch (operation) {
+                    case Operation::Intersection:
+                        if (a == emptySet || b == emptySet) { return emptySet; }
+                        if (a == b) { return a; }
+                        break;
+                    case Operation::Union:
+                        if (a == emptySet || a == b) { return b; }
+                        if (b == emptySet) { return a; }
+                        break;
+                    case Operation::Difference:
+                        if (a == emptySet || a == b) { return emptySet; }
+                        if (b == emptySet) { return a; }
+                        break;
+                    }
+                    assert(slots[a] == slots[b] && a > unitSet);
+                    uint64_t key = ((uint64_t)a << 32) ^ (uint64_t)b;
+                    auto found = memo.find(key);
+                    if (found != memo.end()) { return found->second; }
+
+                    std::vector<size_t> targets(edgeCount(a));
+                    for (size_t i = 0; i < targets.size(); i++) {
+                        targets[i] = apply(operation, target(a, i), target(b, i), memo);
+                    }
+                    size_t result = make(slots[a], targets);
+                    memo[key] = result;
+                    return result;
+                }
+
+                std::shared_ptr<const layout_t> layout;
+                /** Стоимость узлов, входящих во все решения. */
+                Key base;
+                /** Начало альтернатив разряда в weights и nested. */
+                std::vector<size_t> offsets;
+                /** Веса альтернатив всех разрядов. */
+                std::vector<Key> weights;
+                /** Разряды, непосредственно вложенные в альтернативу, по порядку разметки. */
+                std::vector<std::vector<size_t>> nested;
+                /** Разряды, не вложенные ни в один разряд. */
+                std::vector<size_t> topSlots;
+                /** Условие вхождения в решение для каждого узла исходного дерева. */
+                std::unordered_map<const node_t *, std::pair<size_t, size_t>> conditions;
+
+                /** Разряд каждого узла диаграммы. */
+                std::vector<size_t> slots;
+                /** Начало ветвей каждого узла диаграммы в edges. */
+                std::vector<size_t> edgeBegin;
+                std::vector<size_t> edges;
+                std::unordered_map<std::vector<size_t>, size_t, EdgeHash> unique;
+            };
+
+            DecisionDiagram(std::shared_ptr<Store> store, size_t top):
+                store(std::move(store)), top(top) {}
+
+            Key extremePrice(bool maximum) const {
+                assert(!empty());
+                std::vector<Key> memo(store->slots.size());
+                std::vector<bool> known(store->slots.size(), false);
+                return store->base + store->extreme(top, maximum, memo, known);
+            }
+
+            DecisionDiagram combine(const DecisionDiagram &other, Operation operation) const {
+                assert(store == other.store);
+                std::unordered_map<uint64_t, size_t> memo;
+                return DecisionDiagram(store, store->apply(operation, top, other.top, memo));
+            }
+
+            std::shared_ptr<Store> store;
+            /** Номер корневого узла диаграммы. */
+            size_t top;
+        };
+
+        template <typename Key, typename Value>
+        const size_t DecisionDiagram<Key, Value>::emptySet;
+
+        template <typename Key, typename Value>
+        const size_t DecisionDiagram<Key, Value>::unitSet;
+
+        template <typename Key, typename Value>
+        const typename DecisionDiagram<Key, Value>::count_t DecisionDiagram<Key, Value>::unknown;
+
+        /**
+         * Ленивый перебор решений диаграммы в порядке SolutionIterator
+         * (разряды по порядку разметки, альтернативы по возрастанию).
+         * Интерфейс совпадает с итераторами решений, поэтому подходит
+         * для streamSolutions() и solutionViews().
+         */
+        template <typename Key, typename Value>
+        class DiagramIterator {
+        public:
+            typedef DecisionDiagram<Key, Value> diagram_t;
+            typedef SolutionView<Key, Value> view_t;
+
+            explicit DiagramIterator(const diagram_t &diagram):
+                diagram(diagram),
+                store(diagram.store.get())
+            {
+                size_t slotCount = store->layout->size();
+                defaults.resize(slotCount);
+                for (size_t slot = 0; slot < slotCount; slot++) {
+                    const auto *node = store->layout->node(slot);
+                    size_t fixed = fixedChildIndex(node);
+                    defaults[slot] = fixed == node->childCount() ? 0 : fixed;
+                }
+                choices = defaults;
+                if (!diagram.empty()) {
+                    prices.push_back(store->base);
+                    descend(diagram.top);
+                }
+            }
+
+            bool hasSolution() const { return !prices.empty(); }
+
+            view_t currentView() const {
+                assert(hasSolution());
+                return view_t(store->layout, choices, prices.back());
+            }
+
+            /** Переходит к следующему решению; возвращает false, если решения закончились. */
+            bool nextSolution() {
+                while (!path.empty()) {
+                    size_t id = path.back();
+                    size_t slot = store->slots[id];
+                    prices.pop_back();
+                    for (size_t i = choices[slot] + 1; i < store->edgeCount(id); i++) {
+                        if (store->target(id, i) != diagram_t::emptySet) {
+                            choose(id, i);
+                            descend(store->target(id, i));
+                            return true;
+                        }
+                    }
+                    choices[slot] = defaults[slot];
+                    path.pop_back();
+                }
+                prices.clear();
+                return false;
+            }
+
+        private:
+            /** Спускается от узла id по первым непустым ветвям до единичного множества. */
+            void descend(size_t id) {
+                while (id != diagram_t::unitSet) {
+                    size_t i = 0;
+                    while (store->target(id, i) == diagram_t::emptySet) { i++; }
+                    path.push_back(id);
+                    choose(id, i);
+                    id = store->target(id, i);
+                }
+            }
+
+            void choose(size_t id, size_t i) {
+                choices[store->slots[id]] = i;
+                prices.push_back(prices.back() + store->weight(id, i));
+            }
+
+            /** Диаграмма удерживает хранилище узлов. */
+            diagram_t diagram;
+            const typename diagram_t::Store *store;
+            /** Узлы диаграммы на пути к текущему решению. */
+            std::vector<size_t> path;
+            /** Стоимость префикса пути: prices[k] - до выбора в узле path[k]. */
+            std::vector<Key> prices;
+            std::vector<size_t> choices;
+            std::vector<size_t> defaults;
+        };
+    }
+}
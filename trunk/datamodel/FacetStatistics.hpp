@@ -0,0 +1,162 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /**
+         * Количество решений, наименьшая и наибольшая стоимости среди них;
+         * при count == 0 стоимости не определены.
+         */
+        template <typename Key>
+        struct Facet {
+            Facet(): count(0), minPrice(), maxPrice() {}
+            Facet(uint64_t count, const Key &price): count(count), minPrice(price), maxPrice(price) {}
+            Facet(uint64_t count, const Key &minPrice, const Key &maxPrice):
+                count(count), minPrice(minPrice), maxPrice(maxPrice) {}
+
+            bool empty() const { return count == 0; }
+
+            /** Решения, составленные из решения this и решения other. */
+            Facet combined(const Facet &other) const {
+                if (empty() || other.empty()) { return Facet(); }
+                return Facet(count * other.count, minPrice + other.minPrice, maxPrice + other.maxPrice);
+            }
+
+            /** Решения this или other. */
+            Facet merged(const Facet &other) const {
+                if (empty()) { return other; }
+                if (other.empty()) { return *this; }
+                return Facet(count + other.count,
+                             other.minPrice < minPrice ? other.minPrice : minPrice,
+                             maxPrice < other.maxPrice ? other.maxPrice : maxPrice);
+            }
+
+            uint64_t count;
+            Key minPrice;
+            Key maxPrice;
+        };
+
+        /**
+         * Статистика для каждого значения параметра: сколько решений останется
+         * и какова наименьшая стоимость, если выбрать это значение.
+         * Для ребёнка узла выбора это решения, в которых зафиксированный
+         * ребёнок этого узла (если есть) заменён данным, а остальные
+         * зафиксированные узлы сохранены; для остальных узлов - решения
+         * с учётом всех зафиксированных узлов, в которые входит узел.
+         * Рассчитывается за два прохода по дереву вместо перебора решений
+         * для каждого значения: снизу вверх - статистика решений поддерева
+         * (inside), сверху вниз - статистика дополнений поддерева до решения
+         * всего дерева (outside); статистика узла - их произведение.
+         * Дети И-узла получают произведение статистик братьев через
+         * префиксные и суффиксные произведения, т.е. за O(n) в сумме.
+         * Сводка current() по маркам и моделям ("BMW X6: 24 конфигурации
+         * от 3,4 до 6,1 млн") берётся из тех же проходов.
+         * Статистика действительна, пока дерево и зафиксированные узлы
+         * не изменялись.
+         */
+        template <typename Key, typename Value>
+        class FacetStatistics {
+        public:
+            typedef AndOrTree<Key, Value> tree_t;
+            typedef Node<Key, Value> node_t;
+            typedef Facet<Key> facet_t;
+
+            explicit FacetStatistics(const tree_t &source) {
+                const node_t *root = source.getRoot();
+                if (root) {
+                    facets[root] = computeInside(root);
+                    computeOutside(root, facet_t(1, Key()));
+                    inside.clear();
+                }
+            }
+
+            /** Возвращает статистику выбора узла node исходного дерева. */
+            const facet_t & of(const node_t *node) const {
+                auto found = facets.find(node);
+                assert(found != facets.end());
+                return found->second;
+            }
+
+            /**
+             * Возвращает статистику решений текущего множества (при всех
+             * зафиксированных узлах), в которые входит узел node; в отличие
+             * от of(), ребёнок узла выбора, исключённый зафиксированным
+             * братом, получает пустую статистику.
+             */
+            facet_t current(const node_t *node) const {
+                return replaced.count(node) ? facet_t() : of(node);
+            }
+
+        private:
+            facet_t computeInside(const node_t *node) {
+                facet_t result;
+                if (hasChoice(node)) {
+                    size_t fixed = fixedChildIndex(node);
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        facet_t child = computeInside(node->child(i));
+                        if (fixed == node->childCount() || fixed == i) {
+                            result = result.merged(child);
+                        }
+                    }
+                } else {
+                    result = facet_t(1, Key());
+                    for (auto child : *node) {
+                        result = result.combined(computeInside(child));
+                    }
+                }
+                result = result.combined(facet_t(1, node->ownKey()));
+                inside[node] = result;
+                return result;
+            }
+
+            /**
+             * @param outside статистика дополнений поддерева node до решения
+             *     при условии, что node входит в решение
+             */
+            void computeOutside(const node_t *node, const facet_t &outside) {
+                facet_t own = outside.combined(facet_t(1, node->ownKey()));
+                size_t count = node->childCount();
+                if (hasChoice(node)) {
+                    size_t fixed = fixedChildIndex(node);
+                    for (size_t i = 0; i < count; i++) {
+                        const node_t *child = node->child(i);
+                        // значение выбирается вместо зафиксированного
+                        facets[child] = own.combined(inside[child]);
+                        if (fixed != count && fixed != i) { replaced.insert(child); }
+                        computeOutside(child, fixed == count || fixed == i ? own : facet_t());
+                    }
+                } else {
+                    // suffix[i] - произведение статистик детей [i, count)
+                    std::vector<facet_t> suffix(count + 1);
+                    suffix[count] = facet_t(1, Key());
+                    for (size_t i = count; i-- > 0;) {
+                        suffix[i] = inside[node->child(i)].combined(suffix[i + 1]);
+                    }
+                    facet_t prefix = own;
+                    for (size_t i = 0; i < count; i++) {
+                        const node_t *child = node->child(i);
+                        facet_t siblings = prefix.combined(suffix[i + 1]);
+                        facets[child] = siblings.combined(inside[child]);
+                        computeOutside(child, siblings);
+                        prefix = prefix.combined(inside[child]);
+                    }
+                }
+            }
+
+            std::unordered_map<const node_t *, facet_t> inside;
+            std::unordered_map<const node_t *, facet_t> facets;
+            /** Дети узлов выбора, исключённые зафиксированными братьями. */
+            std::unordered_set<const node_t *> replaced;
+        };
+    }
+}
@@ -0,0 +1,194 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+#include "SolutionView.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /**
+         * Множество решений И-ИЛИ дерева в факторизованном виде. Дети
+         * И-узла выбираются независимо, поэтому решения поддерева И-узла -
+         * декартово произведение решений поддеревьев детей, а решения
+         * поддерева узла выбора - объединение решений допустимых
+         * (с учётом зафиксированных узлов) детей. Для каждого узла хранится
+         * только количество решений его поддерева и ссылки на допустимых
+         * детей, т.е. 5 независимых групп по 10 альтернатив занимают
+         * 55 записей детей (5 групп и 50 альтернатив) вместо
+         * 100 000 решений.
+         * Решение по номеру восстанавливается разложением номера:
+         * в смешанной системе счисления по детям И-узла и по накопленным
+         * количествам решений детей узла выбора, за время, пропорциональное
+         * размеру решения. Номера решений совпадают с порядком перебора
+         * SolutionIterator. Множество действительно, пока дерево
+         * и зафиксированные узлы не изменялись.
+         */
+        template <typename Key, typename Value>
+        class FactorizedSolutions {
+        public:
+            typedef AndOrTree<Key, Value> tree_t;
+            typedef Node<Key, Value> node_t;
+            typedef ChoiceLayout<Key, Value> layout_t;
+            typedef SolutionView<Key, Value> view_t;
+
+            explicit FactorizedSolutions(const tree_t &source):
+                layout(std::make_shared<layout_t>(source.getRoot()))
+            {
+                defaults.resize(layout->size());
+                for (size_t slot = 0; slot < defaults.size(); slot++) {
+                    const node_t *node = layout->node(slot);
+                    size_t fixed = fixedChildIndex(node);
+                    defaults[slot] = fixed == node->childCount() ? 0 : fixed;
+                }
+                if (layout->root()) { build(layout->root()); }
+            }
+
+            /** Возвращает количество решений. */
+            uint64_t count() const { return factors.empty() ? 0 : factors[0].count; }
+
+            bool empty() const { return count() == 0; }
+
+            /** Возвращает количество хранимых записей детей (размер представления). */
+            size_t size() const { return children.size(); }
+
+            /** Возвращает решение с номером index в порядке перебора SolutionIterator. */
+            view_t at(uint64_t index) const {
+                assert(index < count());
+                std::vector<size_t> choices(defaults);
+                Key price = Key();
+                decode(0, index, choices, price);
+                return view_t(layout, std::move(choices), price);
+            }
+
+            const std::shared_ptr<const layout_t> & choiceLayout() const { return layout; }
+
+        private:
+            /**
+             * Узел дерева: количество решений поддерева и допустимые дети
+             * children[first, first + childCount); для узла выбора - разряд.
+             */
+            struct Factor {
+                const node_t *node;
+                size_t slot;
+                uint64_t count;
+                size_t first;
+                size_t childCount;
+            };
+
+            /** Ребёнок в представлении: номер записи узла и индекс среди детей узла дерева. */
+            struct Child {
+                Child(size_t factor, size_t index): factor(factor), index(index) {}
+                size_t factor;
+                size_t index;
+            };
+
+            /** Добавляет записи поддерева node; возвращает номер записи node. */
+            size_t build(const node_t *node) {
+                size_t self = factors.size();
+                Factor factor = { node, layout->slotOf(node), 0, 0, 0 };
+                factors.push_back(factor);
+
+                std::vector<Child> own;
+                uint64_t count = 1;
+                if (hasChoice(node)) {
+                    size_t fixed = fixedChildIndex(node);
+                    count = 0;
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        if (fixed != node->childCount() && fixed != i) { continue; }
+                        size_t child = build(node->child(i));
+                        if (factors[child].count == 0) { continue; }
+                        own.push_back(Child(child, i));
+                        count += factors[child].count;
+                    }
+                } else {
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        size_t child = build(node->child(i));
+                        own.push_back(Child(child, i));
+                        count *= factors[child].count;
+                    }
+                }
+                factors[self].count = count;
+                factors[self].first = children.size();
+                factors[self].childCount = own.size();
+                children.insert(children.end(), own.begin(), own.end());
+                return self;
+            }
+
+            /**
+             * Восстанавливает решение поддерева записи factor с номером index.
+             * Разряды упорядочены в порядке обхода с детьми в обратном порядке,
+             * поэтому младший разряд номера для И-узла - первый ребёнок,
+             * а для узла выбора альтернатива старше разрядов её поддерева.
+             */
+            void decode(size_t factor, uint64_t index, std::vector<size_t> &choices, Key &price) const {
+                const Factor &self = factors[factor];
+                price = price + self.node->ownKey();
+                if (self.slot != layout_t::npos) {
+                    for (size_t c = self.first; c < self.first + self.childCount; c++) {
+                        uint64_t childCount = factors[children[c].factor].count;
+                        if (index < childCount) {
+                            choices[self.slot] = children[c].index;
+                            decode(children[c].factor, index, choices, price);
+                            return;
+                        }
+                        index -= childCount;
+                    }
+                    assert(false);
+                } else {
+                    for (size_t c = self.first; c < self.first + self.childCount; c++) {
+                        uint64_t childCount = factors[children[c].factor].count;
+                        decode(children[c].factor, index % childCount, choices, price);
+                        index /= childCount;
+                    }
+                }
+            }
+
+            std::shared_ptr<const layout_t> layout;
+            /** Индексы альтернатив неактивных разрядов. */
+            std::vector<size_t> defaults;
+            /** Записи узлов в порядке обхода; запись корня - первая. */
+            std::vector<Factor> factors;
+            std::vector<Child> children;
+        };
+
+        /**
+         * Перебор факторизованного множества решений по номерам.
+         * Интерфейс совпадает с итераторами решений, поэтому подходит
+         * для streamSolutions() и solutionViews().
+         */
+        template <typename Key, typename Value>
+        class FactorizedIterator {
+        public:
+            typedef FactorizedSolutions<Key, Value> solutions_t;
+            typedef SolutionView<Key, Value> view_t;
+
+            explicit FactorizedIterator(std::shared_ptr<const solutions_t> solutions):
+                solutions(std::move(solutions)), index(0) {}
+
+            bool hasSolution() const { return index < solutions->count(); }
+
+            view_t currentView() const { return solutions->at(index); }
+
+            /** Переходит к следующему решению; возвращает false, если решения закончились. */
+            bool nextSolution() {
+                if (hasSolution()) { index++; }
+                return hasSolution();
+            }
+
+            /** Переходит к решению с номером index. */
+            void seek(uint64_t index) { this->index = index; }
+
+        private:
+            std::shared_ptr<const solutions_t> solutions;
+            uint64_t index;
+        };
+    }
+}
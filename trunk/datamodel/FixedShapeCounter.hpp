@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include <assert.h>
+
+namespace vehicle {
+    namespace algorithm {
+        /**
+         * Максимальное количество разрядов поддерева фиксированной формы,
+         * для которого перебор выполняется развёрнутым счётчиком.
+         */
+        const size_t maxFixedShapeSize = 8;
+
+        /**
+         * Поддерево фиксированной формы: узлы выбора, ни одна альтернатива
+         * которых не содержит других узлов выбора (например, И-узел
+         * с несколькими ИЛИ-узлами из листьев). Такие разряды независимы,
+         * и перебор решений поддерева - это счётчик со смешанным основанием,
+         * младший разряд которого - первый узел выбора в прямом порядке обхода.
+         * Для зафиксированного узла разряд принимает единственное значение
+         * (first = зафиксированный индекс, limit = first + 1).
+         */
+        template <typename NodePtr>
+        struct FixedShape {
+            FixedShape(): root(nullptr), size(0) {}
+
+            /** Корень поддерева. */
+            NodePtr root;
+            /** Количество разрядов. */
+            size_t size;
+            /** Узлы выбора от младшего разряда к старшему. */
+            NodePtr nodes[maxFixedShapeSize];
+            /** Индексы выбранных альтернатив (Choice::index) узлов nodes. */
+            size_t *digits[maxFixedShapeSize];
+            /** Начальные значения разрядов. */
+            size_t firsts[maxFixedShapeSize];
+            /** Границы разрядов (не включительно). */
+            size_t limits[maxFixedShapeSize];
+        };
+
+        namespace internal {
+            /**
+             * Шаг счётчика со смешанным основанием, начиная с разряда Digit
+             * из Size; развёртывается компилятором в линейную
+             * последовательность сравнений без циклов и рекурсии.
+             */
+            template <size_t Digit, size_t Size>
+            struct MixedRadixStep {
+                static size_t next(size_t *const *digits, const size_t *firsts, const size_t *limits) {
+                    if (++*digits[Digit] < limits[Digit]) { return Digit + 1; }
+                    *digits[Digit] = firsts[Digit];
+                    return MixedRadixStep<Digit + 1, Size>::next(digits, firsts, limits);
+                }
+            };
+
+            template <size_t Size>
+            struct MixedRadixStep<Size, Size> {
+                static size_t next(size_t *const *, const size_t *, const size_t *) {
+                    return Size + 1;
+                }
+            };
+        }
+
+        /**
+         * Переводит счётчик со смешанным основанием из Size разрядов
+         * к следующему значению.
+         * @return количество изменённых (младших) разрядов, либо Size + 1
+         *     при переполнении (все разряды возвращены к начальным значениям)
+         */
+        template <size_t Size>
+        size_t nextMixedRadix(size_t *const *digits, const size_t *firsts, const size_t *limits) {
+            return internal::MixedRadixStep<0, Size>::next(digits, firsts, limits);
+        }
+
+        /**
+         * Переводит поддерево фиксированной формы к следующему решению,
+         * выбирая развёрнутый счётчик по количеству разрядов.
+         * @return см. nextMixedRadix
+         */
+        template <typename NodePtr>
+        size_t nextFixedShape(FixedShape<NodePtr> &shape) {
+            static_assert(maxFixedShapeSize == 8, "nextFixedShape dispatches sizes 1..8");
+            switch (shape.size) {
+            case 1: return nextMixedRadix<1>(shape.digits, shape.firsts, shape.limits);
+            case 2: return nextMixedRadix<2>(shape.digits, shape.firsts, shape.limits);
+            case 3: return nextMixedRadix<3>(shape.digits, shape.firsts, shape.limits);
+            case 4: return nextMixedRadix<4>(shape.digits, shape.firsts, shape.limits);
+            case 5: return nextMixedRadix<5>(shape.digits, shape.firsts, shape.limits);
+            case 6: return nextMixedRadix<6>(shape.digits, shape.firsts, shape.limits);
+            case 7: return nextMixedRadix<7>(shape.digits, shape.firsts, shape.limits);
+            case 8: return nextMixedRadix<8>(shape.digits, shape.firsts, shape.limits);
+            default:
+                assert(false);
+                return shape.size + 1;
+            }
+        }
+    }
+}
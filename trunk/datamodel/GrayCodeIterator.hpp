@@ -0,0 +1,350 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <vector>
+
+#include "SolutionIterator.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /**
+         * Итератор решений в порядке отражённого кода Грея со смешанным
+         * основанием: соседние решения отличаются выбором ровно одного
+         * ИЛИ-узла, а стоимость очередного решения получается из стоимости
+         * предыдущего прибавлением одной разности.
+         * Каждый разряд выбора (см. ChoiceLayout) хранит направление
+         * перебора; разряд, дошедший до края, меняет направление и
+         * передаёт шаг следующему по значимости разряду, поэтому поддеревья
+         * невыбранных альтернатив сохраняют своё состояние и продолжают
+         * перебор с него при повторном выборе.
+         * Порядок решений отличается от SolutionIterator, множество
+         * решений и первое решение - те же.
+         * Шаг выполняется за амортизированное O(1):
+         *  - разряды, участвующие в решении, хранятся в двусвязном списке
+         *    от младшего к старшему (вложенные разряды альтернативы
+         *    предшествуют своему разряду); шаг просматривает список с начала
+         *    до первого разряда, не дошедшего до края, как двоичный счётчик,
+         *    а смена альтернативы заменяет в списке блок разрядов старой
+         *    альтернативы блоком новой за O(1); зафиксированные разряды
+         *    и разряды с одной альтернативой в список не входят;
+         *  - альтернатива покидается только после полного перебора своего
+         *    поддерева, поэтому поддерево альтернативы всегда находится
+         *    в одном из двух крайних состояний, стоимости которых
+         *    рассчитываются заранее: разность стоимостей при смене
+         *    альтернативы - одно вычитание, без обновления стоимостей
+         *    охватывающих поддеревьев.
+         * Дерево решения (currentSolution) обновляется по запросу.
+         * Наследование защищённое: переход по номеру и контрольные точки
+         * SolutionIterator (seek, checkpoint, restore) рассчитаны на его
+         * порядок перебора и нарушили бы состояние итератора.
+         */
+        template <typename Key, typename Value>
+        class GrayCodeIterator : protected SolutionIterator<Key, Value> {
+        public:
+            typedef SolutionIterator<Key, Value> base_t;
+            typedef typename base_t::tree_t tree_t;
+            typedef typename base_t::node_t node_t;
+            typedef typename base_t::solution_tree_t solution_tree_t;
+            typedef typename base_t::layout_t layout_t;
+            typedef typename base_t::view_t view_t;
+
+            using base_t::solutionCount;
+            using base_t::hasSolution;
+            using base_t::choiceLayout;
+
+            GrayCodeIterator(const tree_t &source):
+                base_t(source),
+                changedSlot(layout_t::npos)
+            {
+                prepare();
+            }
+
+            bool nextSolution() {
+                if (!this->source.getRoot()) { return false; }
+                size_t slot = next[head()];
+                while (slot != tail() && isAtEdge(slot)) {
+                    forward[slot] = !forward[slot];
+                    slot = next[slot];
+                }
+                if (slot == tail()) {
+                    // все разряды уже сменили направление:
+                    // повторный перебор пойдёт в обратном порядке
+                    changedSlot = layout_t::npos;
+                    return false;
+                }
+
+                size_t index = choice(slot);
+                size_t from = childOffsets[slot] + index;
+                index = forward[slot] ? index + 1 : index - 1;
+                size_t to = childOffsets[slot] + index;
+
+                // блок вложенных разрядов занимает в списке место
+                // между before[slot] и самим разрядом
+                size_t outer = before[slot];
+                if (next[outer] != slot) {
+                    blockFirst[from] = next[outer];
+                    blockLast[from] = prev[slot];
+                }
+                price = price + (subtreePrice(to) - subtreePrice(from));
+                if (blockFirst[to] != layout_t::npos) {
+                    link(outer, blockFirst[to]);
+                    link(blockLast[to], slot);
+                } else {
+                    link(outer, slot);
+                }
+
+                this->choiceNodes[slot]->getValue().index = index;
+                changedSlot = slot;
+                if (!dirty[slot]) {
+                    dirty[slot] = true;
+                    dirtySlots.push_back(slot);
+                }
+                return true;
+            }
+
+            /** Возвращает стоимость текущего решения. */
+            const Key & currentPrice() const {
+                return price;
+            }
+
+            /**
+             * Возвращает разряд (см. ChoiceLayout), выбор в котором изменился
+             * при последнем вызове nextSolution(), либо layout_t::npos
+             * для первого решения.
+             */
+            size_t lastChangedSlot() const {
+                return changedSlot;
+            }
+
+            /**
+             * Возвращает текущее решение; ключи дерева решения
+             * пересчитываются только для изменившихся разрядов.
+             */
+            const solution_tree_t & currentSolution() {
+                for (size_t slot : dirtySlots) {
+                    dirty[slot] = false;
+                    this->solution.recomputeKey(this->choiceNodes[slot]);
+                }
+                dirtySlots.clear();
+                return this->solution;
+            }
+
+            /**
+             * Возвращает компактное представление текущего решения;
+             * дерево решения при этом не пересчитывается.
+             */
+            view_t currentView() const {
+                std::vector<size_t> choices(forward.size());
+                for (size_t slot = 0; slot < choices.size(); slot++) {
+                    choices[slot] = choice(slot);
+                }
+                return view_t(this->layout, std::move(choices), price);
+            }
+
+        private:
+            void prepare() {
+                const auto &layout = *this->layout;
+                size_t count = layout.size();
+                digit.resize(count);
+                forward.assign(count, true);
+                dirty.assign(count, false);
+                const size_t none = layout_t::npos;
+                before.assign(count, none);
+                childOffsets.resize(count + 1, 0);
+                for (size_t slot = 0; slot < count; slot++) {
+                    const node_t *node = layout.node(slot);
+                    digit[slot] = fixedChildIndex(node) == node->childCount() && node->childCount() > 1;
+                    childOffsets[slot + 1] = childOffsets[slot] + node->childCount();
+                }
+                startPrices.assign(childOffsets.back(), Key());
+                endPrices.assign(childOffsets.back(), Key());
+                oddCounts.assign(childOffsets.back(), false);
+                blockFirst.assign(childOffsets.back(), none);
+                blockLast.assign(childOffsets.back(), none);
+                next.assign(count + 2, none);
+                prev.assign(count + 2, none);
+
+                price = Key();
+                const node_t *root = this->source.getRoot();
+                if (!root) {
+                    link(head(), tail());
+                    return;
+                }
+
+                // крайние стоимости альтернатив от вложенных разрядов к охватывающим
+                for (size_t slot = count; slot-- > 0;) {
+                    const node_t *node = layout.node(slot);
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        size_t child = childOffsets[slot] + i;
+                        oddCounts[child] = addPrices(node->child(i), startPrices[child], endPrices[child]);
+                    }
+                }
+                Key unused = Key();
+                addPrices(root, price, unused);
+
+                size_t first = layout_t::npos;
+                size_t last = layout_t::npos;
+                collectDigits(root, head(), first, last);
+                if (first == layout_t::npos) {
+                    link(head(), tail());
+                } else {
+                    link(head(), first);
+                    link(last, tail());
+                }
+            }
+
+            /**
+             * Прибавляет к start и end стоимости поддерева node в начальном
+             * и конечном крайних состояниях; для вложенных разрядов
+             * используются уже рассчитанные стоимости их альтернатив.
+             * Конечное состояние - то, в которое поддерево приходит после
+             * полного перебора: старший разряд выбора проходит все
+             * альтернативы, а младший ребёнок И-узла проходит своё поддерево
+             * столько раз, сколько решений у старших детей, и при чётном
+             * числе проходов возвращается в начальное состояние.
+             * @returns нечётно ли число решений поддерева
+             */
+            bool addPrices(const node_t *node, Key &start, Key &end) const {
+                start = start + node->ownKey();
+                end = end + node->ownKey();
+                if (hasChoice(node)) {
+                    size_t slot = this->layout->slotOf(node);
+                    size_t offset = childOffsets[slot];
+                    start = start + startPrices[offset + choice(slot)];
+                    if (!digit[slot]) {
+                        end = end + endPrices[offset + choice(slot)];
+                        return oddCounts[offset + choice(slot)];
+                    }
+                    end = end + endPrices[offset + node->childCount() - 1];
+                    bool odd = false;
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        odd = odd != oddCounts[offset + i];
+                    }
+                    return odd;
+                }
+                // младшие дети перебираются чаще: идём от старшего
+                bool higherOdd = true;
+                for (size_t i = node->childCount(); i-- > 0;) {
+                    Key childStart = Key();
+                    Key childEnd = Key();
+                    bool odd = addPrices(node->child(i), childStart, childEnd);
+                    start = start + childStart;
+                    end = end + (higherOdd ? childEnd : childStart);
+                    higherOdd = higherOdd && odd;
+                }
+                return higherOdd;
+            }
+
+            /**
+             * Добавляет в список [first, last] разряды поддерева node
+             * в порядке от младшего к старшему; блоки невыбранных альтернатив
+             * связываются отдельно и сохраняются в blockFirst/blockLast.
+             * @param outer разряд, предшествующий в списке поддереву node
+             *     (если first пуст)
+             */
+            void collectDigits(const node_t *node, size_t outer, size_t &first, size_t &last) {
+                if (!hasChoice(node)) {
+                    for (auto child : *node) {
+                        collectDigits(child, outer, first, last);
+                    }
+                    return;
+                }
+                size_t slot = this->layout->slotOf(node);
+                size_t predecessor = last == layout_t::npos ? outer : last;
+                before[slot] = predecessor;
+                for (size_t i = 0; i < node->childCount(); i++) {
+                    if (!digit[slot] && i != choice(slot)) { continue; }
+                    size_t child = childOffsets[slot] + i;
+                    collectDigits(node->child(i), predecessor, blockFirst[child], blockLast[child]);
+                }
+                size_t chosen = childOffsets[slot] + choice(slot);
+                append(first, last, blockFirst[chosen], blockLast[chosen]);
+                if (digit[slot]) { append(first, last, slot, slot); }
+            }
+
+            /** Присоединяет непустой или пустой блок [blockBegin, blockEnd] к списку [first, last]. */
+            void append(size_t &first, size_t &last, size_t blockBegin, size_t blockEnd) {
+                if (blockBegin == layout_t::npos) { return; }
+                if (first == layout_t::npos) {
+                    first = blockBegin;
+                } else {
+                    link(last, blockBegin);
+                }
+                last = blockEnd;
+            }
+
+            void link(size_t left, size_t right) {
+                next[left] = right;
+                prev[right] = left;
+            }
+
+            /** Значение "дошёл ли разряд до края в своём направлении?" */
+            bool isAtEdge(size_t slot) const {
+                size_t index = choice(slot);
+                return forward[slot] ? index + 1 == childCount(slot) : index == 0;
+            }
+
+            /**
+             * Стоимость поддерева невыбранной альтернативы child в текущем
+             * крайнем состоянии. Старший разряд блока меняет направление
+             * ровно один раз за полный перебор блока, поэтому состояние
+             * определяется его направлением.
+             */
+            const Key & subtreePrice(size_t child) const {
+                size_t last = blockLast[child];
+                bool atEnd = last != layout_t::npos && !forward[last];
+                return atEnd ? endPrices[child] : startPrices[child];
+            }
+
+            size_t choice(size_t slot) const {
+                return this->choiceNodes[slot]->getValue().index;
+            }
+
+            size_t childCount(size_t slot) const {
+                return childOffsets[slot + 1] - childOffsets[slot];
+            }
+
+            /** Начало и конец списка разрядов. */
+            size_t head() const { return forward.size(); }
+            size_t tail() const { return forward.size() + 1; }
+
+            Key price;
+            size_t changedSlot;
+
+            /** Значения "перебирается ли разряд?" (не зафиксирован и имеет больше одной альтернативы). */
+            std::vector<bool> digit;
+            /** Направления перебора разрядов: true - к последнему ребёнку. */
+            std::vector<bool> forward;
+
+            /** Начало детей разряда в массивах альтернатив. */
+            std::vector<size_t> childOffsets;
+            /**
+             * Стоимости поддеревьев альтернатив в начальном крайнем
+             * состоянии (все разряды на первых альтернативах) и в конечном
+             * (после полного перебора поддерева), а также значения
+             * "нечётно ли число решений поддерева?"
+             */
+            std::vector<Key> startPrices;
+            std::vector<Key> endPrices;
+            std::vector<bool> oddCounts;
+
+            /**
+             * Список перебираемых разрядов, участвующих в решении, от младшего
+             * к старшему; head() и tail() - ограничители.
+             */
+            std::vector<size_t> next;
+            std::vector<size_t> prev;
+            /** Разряд (или head()), предшествующий в списке поддереву разряда. */
+            std::vector<size_t> before;
+            /** Первый и последний разряды блока альтернативы, если он не в списке. */
+            std::vector<size_t> blockFirst;
+            std::vector<size_t> blockLast;
+
+            /** Разряды, ключи которых не пересчитаны в дереве решения. */
+            std::vector<size_t> dirtySlots;
+            std::vector<bool> dirty;
+        };
+    }
+}
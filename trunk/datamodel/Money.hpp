@@ -0,0 +1,252 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+
+namespace vehicle {
+    namespace core {
+        namespace internal {
+            /** 10 в степени Power. */
+            template <int Power>
+            struct PowerOfTen {
+                static const int64_t value = 10 * PowerOfTen<Power - 1>::value;
+            };
+
+            template <>
+            struct PowerOfTen<0> {
+                static const int64_t value = 1;
+            };
+
+            /** Значение "переполняется ли сумма a + b?" (без ветвлений). */
+            inline bool addOverflows(int64_t a, int64_t b) {
+                int64_t sum = (int64_t)((uint64_t)a + (uint64_t)b);
+                return ((a ^ sum) & (b ^ sum)) < 0;
+            }
+
+            /** Значение "переполняется ли разность a - b?" (без ветвлений). */
+            inline bool subtractOverflows(int64_t a, int64_t b) {
+                int64_t difference = (int64_t)((uint64_t)a - (uint64_t)b);
+                return ((a ^ b) & (a ^ difference)) < 0;
+            }
+
+            /** Частное a / b, округлённое до ближайшего целого (половина - от нуля). */
+            inline int64_t roundedDivide(int64_t a, int64_t b) {
+                int64_t quotient = a / b;
+                int64_t remainder = a % b;
+                int64_t twice = remainder < 0 ? -2 * remainder : 2 * remainder;
+                if (twice >= (b < 0 ? -b : b)) {
+                    quotient += (a < 0) == (b < 0) ? 1 : -1;
+                }
+                return quotient;
+            }
+        }
+
+        /**
+         * Денежная сумма с фиксированной точкой: целое число минимальных
+         * единиц (при Scale = 2 - копеек). Замена decimal2 в качестве
+         * ключа И-ИЛИ дерева: сложение и сравнение - одна целочисленная
+         * команда, без округления и перевода в double, поэтому суммы
+         * ключей при переборе решений и сортировка по стоимости заметно
+         * быстрее. Переполнение при сложении и вычитании проверяется
+         * в отладочной сборке (assert).
+         * Интерфейс совпадает с используемой частью decimal: конструктор
+         * от целого числа рублей, арифметика, сравнения, getAsInteger(),
+         * getUnbiased()/setUnbiased() (см. PriceUnits) и вывод в поток
+         * в том же формате ("42.00"), поэтому хэши Checkpoint не меняются;
+         * запись и разбор без выделения памяти - toChars() и fromChars().
+         * Тип тривиально копируемый и размером с int64_t: массивы сумм
+         * обрабатываются векторными командами (см. minOf(), maxOf()).
+         */
+        template <int Scale>
+        class Money {
+        public:
+            /** Количество минимальных единиц в одной целой. */
+            static const int64_t factor = internal::PowerOfTen<Scale>::value;
+            /** Наибольшая длина записи суммы: знак, 19 цифр, точка и Scale цифр. */
+            static const size_t maxChars = 21 + Scale;
+
+            Money(): units(0) {}
+
+            /** Сумма из value целых единиц. */
+            explicit Money(int64_t value) {
+                assert(value <= std::numeric_limits<int64_t>::max() / factor &&
+                       value >= std::numeric_limits<int64_t>::min() / factor);
+                units = value * factor;
+            }
+
+            /** Возвращает сумму, округлённую до целых единиц (половина - от нуля). */
+            int64_t getAsInteger() const { return internal::roundedDivide(units, factor); }
+
+            /** Возвращает сумму в минимальных единицах. */
+            int64_t getUnbiased() const { return units; }
+            void setUnbiased(int64_t value) { units = value; }
+
+            Money operator+(const Money &other) const {
+                assert(!internal::addOverflows(units, other.units));
+                return fromUnits(units + other.units);
+            }
+
+            Money operator-(const Money &other) const {
+                assert(!internal::subtractOverflows(units, other.units));
+                return fromUnits(units - other.units);
+            }
+
+            Money operator-() const {
+                assert(units != std::numeric_limits<int64_t>::min());
+                return fromUnits(-units);
+            }
+
+            Money & operator+=(const Money &other) { return *this = *this + other; }
+            Money & operator-=(const Money &other) { return *this = *this - other; }
+
+            /**
+             * Произведение сумм с округлением до минимальной единицы (как у decimal).
+             */
+            Money operator*(const Money &other) const {
+                int64_t whole = units / factor;
+                int64_t fraction = units % factor;
+                return fromUnits(whole * other.units + internal::roundedDivide(fraction * other.units, factor));
+            }
+
+            /** Частное сумм с округлением до минимальной единицы. */
+            Money operator/(const Money &other) const {
+                assert(other.units != 0);
+                int64_t whole = units / other.units;
+                int64_t remainder = units % other.units;
+                return fromUnits(whole * factor + internal::roundedDivide(remainder * factor, other.units));
+            }
+
+            bool operator==(const Money &other) const { return units == other.units; }
+            bool operator!=(const Money &other) const { return units != other.units; }
+            bool operator<(const Money &other) const { return units < other.units; }
+            bool operator>(const Money &other) const { return units > other.units; }
+            bool operator<=(const Money &other) const { return units <= other.units; }
+            bool operator>=(const Money &other) const { return units >= other.units; }
+
+            /** Возвращает сумму из value минимальных единиц. */
+            static Money fromUnits(int64_t value) {
+                Money result;
+                result.units = value;
+                return result;
+            }
+
+        private:
+            int64_t units;
+        };
+
+        template <int Scale>
+        const int64_t Money<Scale>::factor;
+
+        template <int Scale>
+        const size_t Money<Scale>::maxChars;
+
+        /** Сумма в копейках: замена decimal2. */
+        typedef Money<2> money2;
+
+        /**
+         * Меньшая из сумм. Выбор без ветвлений, поэтому цикл по массиву
+         * сумм векторизуется (в отличие от std::min, возвращающего ссылку).
+         */
+        template <int Scale>
+        inline Money<Scale> minOf(const Money<Scale> &a, const Money<Scale> &b) {
+            int64_t x = a.getUnbiased();
+            int64_t y = b.getUnbiased();
+            return Money<Scale>::fromUnits(x < y ? x : y);
+        }
+
+        /** Большая из сумм (см. minOf()). */
+        template <int Scale>
+        inline Money<Scale> maxOf(const Money<Scale> &a, const Money<Scale> &b) {
+            int64_t x = a.getUnbiased();
+            int64_t y = b.getUnbiased();
+            return Money<Scale>::fromUnits(x < y ? y : x);
+        }
+
+        /**
+         * Записывает сумму в [first, last) с Scale знаками после точки,
+         * как decimal ("-12.05"), без потоков, локали и выделения памяти.
+         * Char - char, wchar_t или 16-битный символ (QString::utf16()).
+         * Возвращает указатель за последним записанным символом либо
+         * nullptr, если запись не помещается в буфер (для буфера
+         * из Money::maxChars символов такого не бывает).
+         */
+        template <typename Char, int Scale>
+        Char * toChars(Char *first, Char *last, const Money<Scale> &money) {
+            Char digits[Money<Scale>::maxChars];
+            Char *end = digits + Money<Scale>::maxChars;
+            Char *begin = end;
+            int64_t units = money.getUnbiased();
+            uint64_t magnitude = units < 0 ? 0 - (uint64_t)units : (uint64_t)units;
+            for (int i = 0; i < Scale; i++) {
+                *--begin = (Char)('0' + magnitude % 10);
+                magnitude /= 10;
+            }
+            if (Scale > 0) { *--begin = (Char)'.'; }
+            do {
+                *--begin = (Char)('0' + magnitude % 10);
+                magnitude /= 10;
+            } while (magnitude > 0);
+            if (units < 0) { *--begin = (Char)'-'; }
+            if (last - first < end - begin) { return nullptr; }
+            return std::copy(begin, end, first);
+        }
+
+        /**
+         * Разбирает сумму "[-]цифры[.цифры]" в начале [first, last) без
+         * потоков, локали и выделения памяти; знаки после точки сверх Scale
+         * округляются (половина - от нуля). Целые суммы ("503000"), как
+         * в файлах модели, тоже разбираются. Возвращает указатель
+         * за разобранной частью либо nullptr, если в начале нет числа
+         * или сумма не помещается в Money.
+         */
+        template <typename Char, int Scale>
+        const Char * fromChars(const Char *first, const Char *last, Money<Scale> &money) {
+            const Char *current = first;
+            bool negative = current != last && *current == '-';
+            if (negative || (current != last && *current == '+')) { current++; }
+            const uint64_t factor = (uint64_t)Money<Scale>::factor;
+            const uint64_t limit = (uint64_t)std::numeric_limits<int64_t>::max() + (negative ? 1 : 0);
+
+            bool digits = false;
+            uint64_t whole = 0;
+            for (; current != last && *current >= '0' && *current <= '9'; current++) {
+                uint64_t digit = (uint64_t)(*current - '0');
+                if (whole > (limit / factor - digit) / 10) { return nullptr; }
+                whole = whole * 10 + digit;
+                digits = true;
+            }
+            uint64_t fraction = 0;
+            uint64_t place = factor;
+            if (current != last && *current == '.') {
+                for (current++; current != last && *current >= '0' && *current <= '9'; current++) {
+                    uint64_t digit = (uint64_t)(*current - '0');
+                    if (place > 1) {
+                        place /= 10;
+                        fraction += digit * place;
+                    } else if (place == 1) {
+                        // первый отброшенный знак определяет округление
+                        fraction += digit >= 5 ? 1 : 0;
+                        place = 0;
+                    }
+                    digits = true;
+                }
+            }
+            if (!digits) { return nullptr; }
+            uint64_t units = whole * factor;
+            if (units > limit - fraction) { return nullptr; }
+            units += fraction;
+            money.setUnbiased(negative ? (int64_t)(0 - units) : (int64_t)units);
+            return current;
+        }
+
+        template <int Scale>
+        std::ostream & operator<<(std::ostream &os, const Money<Scale> &money) {
+            char buffer[Money<Scale>::maxChars];
+            char *end = toChars(buffer, buffer + Money<Scale>::maxChars, money);
+            return os.write(buffer, end - buffer);
+        }
+    }
+}
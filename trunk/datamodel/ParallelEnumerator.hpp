@@ -0,0 +1,105 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "SolutionIterator.hpp"
+#include "WorkStealingPool.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /** Порядок выдачи результатов параллельного перебора. */
+        enum class ResultOrder {
+            /** В порядке перебора SolutionIterator. */
+            Enumeration,
+            /** В порядке готовности частей перебора. */
+            Completion
+        };
+
+        /**
+         * Параллельный перебор решений И-ИЛИ дерева.
+         * Множество решений делится на непересекающиеся диапазоны номеров
+         * (в порядке перебора SolutionIterator), которые перебираются
+         * независимыми копиями итератора (см. SolutionIterator::seek)
+         * в пуле потоков с перехватом задач. Частей больше, чем потоков,
+         * чтобы неравномерные по стоимости диапазоны выравнивались перехватом.
+         */
+        template <typename Key, typename Value>
+        class ParallelEnumerator {
+        public:
+            typedef SolutionIterator<Key, Value> iterator_t;
+            typedef typename iterator_t::tree_t tree_t;
+
+            /**
+             * @param source исходное дерево; не должно изменяться во время перебора
+             * @param threadCount количество потоков; 0 - по количеству аппаратных потоков
+             * @param partitionsPerThread количество частей перебора на поток
+             */
+            explicit ParallelEnumerator(const tree_t &source, size_t threadCount = 0, size_t partitionsPerThread = 8):
+                prototype(source),
+                pool(threadCount),
+                partitionsPerThread(std::max(partitionsPerThread, (size_t)1)),
+                count(prototype.solutionCount()) {}
+
+            /** Возвращает количество решений. */
+            size_t solutionCount() const { return count; }
+
+            /** Возвращает количество потоков перебора. */
+            size_t threadCount() const { return pool.size(); }
+
+            /**
+             * Вызывает map(iterator) для каждого решения и возвращает результаты.
+             * map вызывается одновременно из нескольких потоков с итератором,
+             * установленным на очередное решение (см. currentSolution()),
+             * и не должен его изменять.
+             * @param order ResultOrder::Enumeration - результаты в порядке перебора
+             *     SolutionIterator, ResultOrder::Completion - частями по мере готовности
+             */
+            template <typename Result, typename Map>
+            std::vector<Result> map(Map map, ResultOrder order = ResultOrder::Enumeration) {
+                size_t partitions = std::min(count, pool.size() * partitionsPerThread);
+                std::vector<std::vector<Result>> parts(partitions);
+                std::vector<Result> results;
+                results.reserve(count);
+                std::mutex resultsMutex;
+
+                pool.run(partitions, [&] (size_t partition) {
+                    size_t begin = count * partition / partitions;
+                    size_t end = count * (partition + 1) / partitions;
+
+                    std::vector<Result> &part = parts[partition];
+                    part.reserve(end - begin);
+                    iterator_t iterator(prototype);
+                    iterator.seek(begin);
+                    for (size_t index = begin; ; ) {
+                        part.push_back(map(static_cast<const iterator_t &>(iterator)));
+                        if (++index == end) { break; }
+                        iterator.nextSolution();
+                    }
+
+                    if (order == ResultOrder::Completion) {
+                        std::lock_guard<std::mutex> lock(resultsMutex);
+                        results.insert(results.end(), part.begin(), part.end());
+                        std::vector<Result>().swap(part);
+                    }
+                });
+
+                if (order == ResultOrder::Enumeration) {
+                    for (auto &part : parts) {
+                        results.insert(results.end(), part.begin(), part.end());
+                    }
+                }
+                return results;
+            }
+
+        private:
+            const iterator_t prototype;
+            WorkStealingPool pool;
+            size_t partitionsPerThread;
+            size_t count;
+        };
+    }
+}
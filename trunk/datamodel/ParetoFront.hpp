@@ -0,0 +1,230 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+#include "SolutionView.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /** Направление оптимизации атрибута. */
+        enum class Goal { Minimize, Maximize };
+
+        /**
+         * Критерий Парето-оптимальности: числовой атрибут содержимого узла
+         * (мощность, масса, расход топлива), который суммируется по всем
+         * узлам решения, и направление его оптимизации.
+         */
+        template <typename Value>
+        struct Criterion {
+            Criterion(std::function<double(const Value &)> attribute, Goal goal):
+                attribute(std::move(attribute)), goal(goal) {}
+            std::function<double(const Value &)> attribute;
+            Goal goal;
+        };
+
+        /** Парето-оптимальное решение: представление и значения критериев. */
+        template <typename Key, typename Value>
+        struct ParetoSolution {
+            ParetoSolution(SolutionView<Key, Value> solution, std::vector<double> attributes):
+                solution(std::move(solution)), attributes(std::move(attributes)) {}
+
+            Key price() const { return solution.totalPrice(); }
+
+            SolutionView<Key, Value> solution;
+            /** Суммарные значения атрибутов в порядке критериев. */
+            std::vector<double> attributes;
+        };
+
+        /**
+         * Парето-оптимальные решения И-ИЛИ дерева по стоимости (минимизируется)
+         * и набору критериев с учётом зафиксированных узлов.
+         * Множества Парето строятся снизу вверх: для узла выбора объединяются
+         * множества детей, для остальных узлов - складываются попарно
+         * (по одному частичному решению от каждого ребёнка), после чего
+         * из множества удаляются доминируемые частичные решения. Так как
+         * стоимость и атрибуты складываются, частичное решение, доминируемое
+         * в поддереве, не может войти ни в одно оптимальное решение, т.е.
+         * перебирается не пространство решений, а только фронты поддеревьев.
+         * Из решений с одинаковыми стоимостью и значениями критериев
+         * остаётся одно. Решения упорядочены по возрастанию стоимости.
+         */
+        template <typename Key, typename Value>
+        class ParetoFront {
+        public:
+            typedef AndOrTree<Key, Value> tree_t;
+            typedef Node<Key, Value> node_t;
+            typedef ChoiceLayout<Key, Value> layout_t;
+            typedef SolutionView<Key, Value> view_t;
+            typedef Criterion<Value> criterion_t;
+            typedef ParetoSolution<Key, Value> solution_t;
+
+            ParetoFront(const tree_t &source, std::vector<criterion_t> criteria):
+                layout(std::make_shared<layout_t>(source.getRoot())),
+                criteria(std::move(criteria))
+            {
+                const node_t *root = layout->root();
+                if (!root) { return; }
+                const std::vector<Point> &front = compute(root);
+
+                std::vector<size_t> defaults(layout->size());
+                for (size_t slot = 0; slot < defaults.size(); slot++) {
+                    const node_t *node = layout->node(slot);
+                    size_t fixed = fixedChildIndex(node);
+                    defaults[slot] = fixed == node->childCount() ? 0 : fixed;
+                }
+                for (size_t i = 0; i < front.size(); i++) {
+                    std::vector<size_t> choices = defaults;
+                    reconstruct(root, i, choices);
+                    std::vector<double> attributes(front[i].values);
+                    for (size_t k = 0; k < attributes.size(); k++) {
+                        if (this->criteria[k].goal == Goal::Maximize) { attributes[k] = -attributes[k]; }
+                    }
+                    result.push_back(solution_t(view_t(layout, std::move(choices), front[i].price), std::move(attributes)));
+                }
+                fronts.clear();
+            }
+
+            /** Возвращает Парето-оптимальные решения по возрастанию стоимости. */
+            const std::vector<solution_t> & solutions() const { return result; }
+
+        private:
+            /**
+             * Частичное решение поддерева. Значения критериев хранятся
+             * со знаком, при котором все критерии минимизируются.
+             * parts - для узла выбора: индекс ребёнка и номер частичного
+             * решения в его множестве, иначе - номера частичных решений детей.
+             */
+            struct Point {
+                Key price;
+                std::vector<double> values;
+                std::vector<size_t> parts;
+            };
+
+            const std::vector<Point> & compute(const node_t *node) {
+                std::vector<Point> points;
+                if (hasChoice(node)) {
+                    size_t fixed = fixedChildIndex(node);
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        if (fixed != node->childCount() && fixed != i) { continue; }
+                        const std::vector<Point> &childPoints = compute(node->child(i));
+                        for (size_t j = 0; j < childPoints.size(); j++) {
+                            Point point = childPoints[j];
+                            point.parts.clear();
+                            point.parts.push_back(i);
+                            point.parts.push_back(j);
+                            points.push_back(std::move(point));
+                        }
+                    }
+                } else {
+                    Point empty;
+                    empty.price = Key();
+                    empty.values.assign(criteria.size(), 0.0);
+                    points.push_back(empty);
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        const std::vector<Point> &childPoints = compute(node->child(i));
+                        std::vector<Point> combined;
+                        combined.reserve(points.size() * childPoints.size());
+                        for (auto &point : points) {
+                            for (size_t j = 0; j < childPoints.size(); j++) {
+                                Point sum;
+                                sum.price = point.price + childPoints[j].price;
+                                sum.values = point.values;
+                                for (size_t k = 0; k < sum.values.size(); k++) {
+                                    sum.values[k] += childPoints[j].values[k];
+                                }
+                                sum.parts = point.parts;
+                                sum.parts.push_back(j);
+                                combined.push_back(std::move(sum));
+                            }
+                        }
+                        prune(combined);
+                        points.swap(combined);
+                    }
+                }
+
+                for (auto &point : points) {
+                    point.price = point.price + node->ownKey();
+                    for (size_t k = 0; k < criteria.size(); k++) {
+                        double value = criteria[k].attribute(node->getValue());
+                        point.values[k] += criteria[k].goal == Goal::Maximize ? -value : value;
+                    }
+                }
+                prune(points);
+                std::vector<Point> &front = fronts[node];
+                front.swap(points);
+                return front;
+            }
+
+            /**
+             * Удаляет доминируемые частичные решения. После сортировки по
+             * стоимости и значениям частичное решение может доминироваться
+             * только одним из предшествующих.
+             */
+            static void prune(std::vector<Point> &points) {
+                std::stable_sort(points.begin(), points.end(), [] (const Point &a, const Point &b) {
+                    if (a.price < b.price) { return true; }
+                    if (b.price < a.price) { return false; }
+                    return a.values < b.values;
+                });
+                std::vector<Point> kept;
+                for (auto &point : points) {
+                    bool dominated = false;
+                    for (auto &other : kept) {
+                        if (dominates(other, point)) { dominated = true; break; }
+                    }
+                    if (!dominated) { kept.push_back(std::move(point)); }
+                }
+                points.swap(kept);
+            }
+
+            /** Значение "не хуже ли a, чем b, по всем критериям?" */
+            static bool dominates(const Point &a, const Point &b) {
+                if (b.price < a.price) { return false; }
+                for (size_t k = 0; k < a.values.size(); k++) {
+                    if (b.values[k] < a.values[k]) { return false; }
+                }
+                return true;
+            }
+
+            void reconstruct(const node_t *node, size_t index, std::vector<size_t> &choices) const {
+                const Point &point = fronts.find(node)->second[index];
+                if (hasChoice(node)) {
+                    choices[layout->slotOf(node)] = point.parts[0];
+                    reconstruct(node->child(point.parts[0]), point.parts[1], choices);
+                } else {
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        reconstruct(node->child(i), point.parts[i], choices);
+                    }
+                }
+            }
+
+            std::shared_ptr<const layout_t> layout;
+            std::vector<criterion_t> criteria;
+            /** Фронты поддеревьев; нужны только для восстановления решений. */
+            std::unordered_map<const node_t *, std::vector<Point>> fronts;
+            std::vector<solution_t> result;
+        };
+
+        /**
+         * Возвращает Парето-оптимальные решения дерева source по стоимости
+         * и критериям criteria.
+         * @see ParetoFront
+         */
+        template <typename Key, typename Value>
+        std::vector<ParetoSolution<Key, Value>> paretoSolutions(
+            const AndOrTree<Key, Value> &source, std::vector<Criterion<Value>> criteria)
+        {
+            return ParetoFront<Key, Value>(source, std::move(criteria)).solutions();
+        }
+    }
+}
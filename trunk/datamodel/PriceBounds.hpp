@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <unordered_map>
+
+#include "ChoiceLayout.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /** Диапазон стоимостей решений [min, max]. */
+        template <typename Key>
+        struct PriceRange {
+            PriceRange() {}
+            PriceRange(const Key &min, const Key &max): min(min), max(max) {}
+
+            /** Значение "попадает ли стоимость key в диапазон?" */
+            bool contains(const Key &key) const { return !(key < min) && !(max < key); }
+            /** Значение "пересекается ли диапазон с диапазоном other?" */
+            bool intersects(const PriceRange &other) const {
+                return !(other.max < min) && !(max < other.min);
+            }
+
+            Key min;
+            Key max;
+        };
+
+        /**
+         * Минимальная и максимальная стоимость решений каждого поддерева
+         * исходного дерева с учётом зафиксированных узлов: у ИЛИ-узла
+         * с зафиксированным ребёнком рассматривается только этот ребёнок.
+         * Узлы, не являющиеся узлами выбора, суммируют стоимости детей
+         * (как в SolutionIterator).
+         * Рассчитывается за один обход дерева; при изменении ключей
+         * или зафиксированных узлов должна строиться заново.
+         */
+        template <typename Key, typename Value>
+        class PriceBounds {
+        public:
+            typedef Node<Key, Value> node_t;
+            typedef PriceRange<Key> range_t;
+
+            explicit PriceBounds(const node_t *root) {
+                if (root) { compute(root); }
+            }
+
+            /** Возвращает диапазон стоимостей поддерева с корнем в узле node. */
+            const range_t & of(const node_t *node) const {
+                auto it = ranges.find(node);
+                assert(it != ranges.end());
+                return it->second;
+            }
+
+        private:
+            const range_t & compute(const node_t *node) {
+                range_t range(node->ownKey(), node->ownKey());
+                if (hasChoice(node)) {
+                    size_t fixedIndex = fixedChildIndex(node);
+                    bool first = true;
+                    Key min, max;
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        const range_t &child = compute(node->child(i));
+                        if (fixedIndex != node->childCount() && i != fixedIndex) { continue; }
+                        if (first || child.min < min) { min = child.min; }
+                        if (first || max < child.max) { max = child.max; }
+                        first = false;
+                    }
+                    range.min = range.min + min;
+                    range.max = range.max + max;
+                } else {
+                    for (auto child : *node) {
+                        const range_t &childRange = compute(child);
+                        range.min = range.min + childRange.min;
+                        range.max = range.max + childRange.max;
+                    }
+                }
+                return ranges[node] = range;
+            }
+
+            std::unordered_map<const node_t *, range_t> ranges;
+        };
+    }
+}
@@ -0,0 +1,245 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+#include "PriceBounds.hpp"
+#include "PriceKernel.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /** Корзина гистограммы стоимостей: решения со стоимостью в [from, to). */
+        template <typename Key>
+        struct PriceBucket {
+            PriceBucket(const Key &from, const Key &to, uint64_t count):
+                from(from), to(to), count(count) {}
+            Key from;
+            Key to;
+            uint64_t count;
+        };
+
+        /**
+         * Точное распределение стоимостей решений И-ИЛИ дерева
+         * с учётом зафиксированных узлов, рассчитанное без перебора решений:
+         * распределения детей объединяются снизу вверх - суммируются
+         * для узла выбора и сворачиваются (свёртка) для остальных узлов,
+         * после чего сдвигаются на собственный ключ узла.
+         * Стоимости переводятся в целое число единиц resolution через
+         * PriceUnits; по умолчанию resolution - минимальная единица ключа
+         * (копейка), и распределение точное. Более крупный шаг (например,
+         * Key(1) - целые рубли) уменьшает количество различных стоимостей,
+         * но каждый ключ округляется до ближайшей кратной величины,
+         * и подсчёты по бюджету становятся приближёнными.
+         * Распределение хранится разреженно - только встречающиеся
+         * стоимости с количеством решений, упорядоченные по стоимости,
+         * поэтому память и время свёртки (произведение количеств
+         * различных стоимостей) не зависят от размаха стоимостей;
+         * на корзины гистограммы стоимости делятся только при выводе.
+         * Накопленные суммы рассчитываются вместе с распределением, поэтому
+         * количество решений не дороже бюджета или в окне стоимостей
+         * возвращается за O(log n) по количеству различных стоимостей.
+         */
+        template <typename Key, typename Value>
+        class PriceDistribution {
+        public:
+            typedef AndOrTree<Key, Value> tree_t;
+            typedef Node<Key, Value> node_t;
+            typedef uint64_t count_t;
+            typedef PriceBucket<Key> bucket_t;
+            typedef PriceRange<Key> range_t;
+
+            explicit PriceDistribution(const tree_t &source, const Key &resolution = PriceUnits<Key>::from(1)):
+                step(PriceUnits<Key>::of(resolution))
+            {
+                assert(step > 0);
+                Density density;
+                if (source.getRoot()) {
+                    density = compute(source.getRoot());
+                }
+                units.reserve(density.size());
+                cumulative.reserve(density.size() + 1);
+                cumulative.push_back(0);
+                for (auto &point : density) {
+                    units.push_back(point.first);
+                    cumulative.push_back(cumulative.back() + point.second);
+                }
+            }
+
+            /** Возвращает количество решений. */
+            count_t total() const {
+                return cumulative.back();
+            }
+
+            /** Возвращает количество решений стоимостью не больше budget. */
+            count_t countAtMost(const Key &budget) const {
+                int64_t last = unitsOf(budget);
+                if (budget < priceOf(last)) { last--; }
+                return prefix(last + 1);
+            }
+
+            /** Возвращает количество решений, стоимость которых попадает в окно window. */
+            count_t countWithin(const range_t &window) const {
+                if (window.max < window.min) { return 0; }
+                int64_t first = unitsOf(window.min);
+                if (priceOf(first) < window.min) { first++; }
+                int64_t last = unitsOf(window.max);
+                if (window.max < priceOf(last)) { last--; }
+                return first > last ? 0 : prefix(last + 1) - prefix(first);
+            }
+
+            /** Значение "есть ли хотя бы одно решение?" */
+            bool empty() const { return units.empty(); }
+
+            /** Возвращает минимальную стоимость решения. */
+            Key minPrice() const { return priceOf(units.front()); }
+
+            /** Возвращает максимальную стоимость решения. */
+            Key maxPrice() const { return priceOf(units.back()); }
+
+            /** Возвращает количество решений со стоимостью price. */
+            count_t count(const Key &price) const {
+                int64_t value = unitsOf(price);
+                return prefix(value + 1) - prefix(value);
+            }
+
+            /**
+             * Возвращает гистограмму с корзинами ширины width (кратной resolution),
+             * начиная с минимальной стоимости; пустые корзины включаются.
+             */
+            std::vector<bucket_t> histogram(const Key &width) const {
+                int64_t step = std::max(unitsOf(width), (int64_t)1);
+                std::vector<bucket_t> buckets;
+                size_t point = 0;
+                for (int64_t begin = empty() ? 0 : units.front(); point < units.size(); begin += step) {
+                    size_t end = point;
+                    while (end < units.size() && units[end] < begin + step) { end++; }
+                    buckets.push_back(bucket_t(priceOf(begin), priceOf(begin + step),
+                                               cumulative[end] - cumulative[point]));
+                    point = end;
+                }
+                return buckets;
+            }
+
+            /**
+             * Возвращает гистограмму из bucketCount корзин одинаковой ширины,
+             * покрывающих стоимости от минимальной до максимальной.
+             */
+            std::vector<bucket_t> histogram(size_t bucketCount) const {
+                assert(bucketCount > 0);
+                int64_t span = empty() ? 0 : units.back() - units.front() + 1;
+                int64_t step = (span + (int64_t)bucketCount - 1) / (int64_t)bucketCount;
+                return histogram(priceOf(std::max(step, (int64_t)1)) - priceOf(0));
+            }
+
+        private:
+            /**
+             * Распределение в единицах resolution: пары (стоимость, количество
+             * решений) по возрастанию стоимости, количества не нулевые.
+             */
+            typedef std::vector<std::pair<int64_t, count_t> > Density;
+
+            /** Количество решений стоимостью меньше value единиц. */
+            count_t prefix(int64_t value) const {
+                size_t index = std::lower_bound(units.begin(), units.end(), value) - units.begin();
+                return cumulative[index];
+            }
+
+            Density compute(const node_t *node) const {
+                Density result;
+                if (hasChoice(node)) {
+                    size_t fixed = fixedChildIndex(node);
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        if (fixed != node->childCount() && i != fixed) { continue; }
+                        Density child = compute(node->child(i));
+                        if (result.empty()) {
+                            result.swap(child);
+                        } else {
+                            result = add(result, child);
+                        }
+                    }
+                } else {
+                    result.push_back(std::make_pair((int64_t)0, (count_t)1));
+                    for (auto child : *node) {
+                        result = convolve(result, compute(child));
+                    }
+                }
+                int64_t own = unitsOf(node->ownKey());
+                for (auto &point : result) { point.first += own; }
+                return result;
+            }
+
+            /** Сумма распределений (слияние упорядоченных пар). */
+            static Density add(const Density &a, const Density &b) {
+                Density result;
+                result.reserve(a.size() + b.size());
+                size_t i = 0, j = 0;
+                while (i < a.size() || j < b.size()) {
+                    if (j == b.size() || (i < a.size() && a[i].first < b[j].first)) {
+                        result.push_back(a[i++]);
+                    } else if (i == a.size() || b[j].first < a[i].first) {
+                        result.push_back(b[j++]);
+                    } else {
+                        result.push_back(std::make_pair(a[i].first, a[i].second + b[j].second));
+                        i++;
+                        j++;
+                    }
+                }
+                return result;
+            }
+
+            /**
+             * Свёртка распределений: стоимости независимых поддеревьев складываются.
+             * Перебираются только пары встречающихся стоимостей, затем
+             * суммы упорядочиваются и совпадающие объединяются.
+             */
+            static Density convolve(const Density &a, const Density &b) {
+                Density sums;
+                sums.reserve(a.size() * b.size());
+                for (auto &x : a) {
+                    for (auto &y : b) {
+                        sums.push_back(std::make_pair(x.first + y.first, x.second * y.second));
+                    }
+                }
+                std::sort(sums.begin(), sums.end());
+                Density result;
+                for (auto &point : sums) {
+                    if (!result.empty() && result.back().first == point.first) {
+                        result.back().second += point.second;
+                    } else {
+                        result.push_back(point);
+                    }
+                }
+                return result;
+            }
+
+            /** Стоимость в единицах resolution, округлённая до ближайшей (половина - от нуля). */
+            int64_t unitsOf(const Key &price) const {
+                int64_t value = PriceUnits<Key>::of(price);
+                int64_t quotient = value / step;
+                int64_t remainder = value % step;
+                if (2 * (remainder < 0 ? -remainder : remainder) >= step) {
+                    quotient += value < 0 ? -1 : 1;
+                }
+                return quotient;
+            }
+
+            Key priceOf(int64_t value) const {
+                return PriceUnits<Key>::from(value * step);
+            }
+
+            /** resolution в минимальных единицах ключа. */
+            int64_t step;
+            /** Встречающиеся стоимости решений в единицах resolution по возрастанию. */
+            std::vector<int64_t> units;
+            /** cumulative[i] - количество решений стоимостью меньше units[i]. */
+            std::vector<count_t> cumulative;
+        };
+    }
+}
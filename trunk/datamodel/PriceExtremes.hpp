@@ -0,0 +1,145 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+#include "PriceBounds.hpp"
+#include "SolutionView.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /** Критерий выбора решения: самое дешёвое или самое дорогое. */
+        enum class PricePolicy { Min, Max };
+
+        /**
+         * Самое дешёвое и самое дорогое решения И-ИЛИ дерева с учётом
+         * зафиксированных узлов, восстановленные без перебора решений:
+         * диапазоны стоимостей поддеревьев (PriceBounds) рассчитываются
+         * один раз, после чего решение строится спуском от корня,
+         * в котором в каждом узле выбора берётся альтернатива с наименьшей
+         * (наибольшей) границей; из равных - первая. Каждое решение
+         * строится за O(n).
+         * Можно потребовать, чтобы решение содержало заданный узел
+         * (например, модель автомобиля) - так получаются цены "от" и "до"
+         * для каждой модели.
+         * Исходное дерево не должно изменяться, пока используется объект.
+         */
+        template <typename Key, typename Value>
+        class PriceExtremes {
+        public:
+            typedef AndOrTree<Key, Value> tree_t;
+            typedef Node<Key, Value> node_t;
+            typedef ChoiceLayout<Key, Value> layout_t;
+            typedef SolutionView<Key, Value> view_t;
+
+            explicit PriceExtremes(const tree_t &source):
+                layout(std::make_shared<layout_t>(source.getRoot())),
+                bounds(source.getRoot())
+            {}
+
+            /** Возвращает самое дешёвое решение, содержащее узел required. */
+            view_t cheapest(const node_t *required = nullptr) const {
+                return find(PricePolicy::Min, required);
+            }
+
+            /** Возвращает самое дорогое решение, содержащее узел required. */
+            view_t mostExpensive(const node_t *required = nullptr) const {
+                return find(PricePolicy::Max, required);
+            }
+
+            /**
+             * Возвращает решение с наименьшей или наибольшей стоимостью.
+             * @param required узел, который должен входить в решение, либо nullptr
+             * @return пустое представление (root() == nullptr), если решений нет:
+             *     дерево пусто или узел required исключён зафиксированными узлами
+             */
+            view_t find(PricePolicy policy, const node_t *required = nullptr) const {
+                const node_t *root = layout->root();
+                if (!root) { return view_t(); }
+                // ветви, ведущие от корня к узлу required
+                std::unordered_map<const node_t *, size_t> path;
+                if (required && !findPath(root, required, path)) { return view_t(); }
+
+                std::vector<size_t> choices(layout->size());
+                for (size_t slot = 0; slot < choices.size(); slot++) {
+                    const node_t *node = layout->node(slot);
+                    size_t fixed = fixedChildIndex(node);
+                    choices[slot] = fixed == node->childCount() ? 0 : fixed;
+                }
+                Key price = Key();
+                if (!descend(root, policy, path, choices, price)) { return view_t(); }
+                return view_t(layout, std::move(choices), price);
+            }
+
+        private:
+            bool findPath(const node_t *node, const node_t *required,
+                          std::unordered_map<const node_t *, size_t> &path) const
+            {
+                if (node == required) { return true; }
+                for (size_t i = 0; i < node->childCount(); i++) {
+                    if (findPath(node->child(i), required, path)) {
+                        path[node] = i;
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            bool descend(const node_t *node, PricePolicy policy,
+                         const std::unordered_map<const node_t *, size_t> &path,
+                         std::vector<size_t> &choices, Key &price) const
+            {
+                price = price + node->ownKey();
+                if (!hasChoice(node)) {
+                    for (auto child : *node) {
+                        if (!descend(child, policy, path, choices, price)) { return false; }
+                    }
+                    return true;
+                }
+                size_t fixed = fixedChildIndex(node);
+                size_t chosen;
+                auto onPath = path.find(node);
+                if (onPath != path.end()) {
+                    chosen = onPath->second;
+                    if (fixed != node->childCount() && fixed != chosen) { return false; }
+                } else if (fixed != node->childCount()) {
+                    chosen = fixed;
+                } else {
+                    chosen = 0;
+                    for (size_t i = 1; i < node->childCount(); i++) {
+                        if (isBetter(policy, node->child(i), node->child(chosen))) { chosen = i; }
+                    }
+                }
+                choices[layout->slotOf(node)] = chosen;
+                return descend(node->child(chosen), policy, path, choices, price);
+            }
+
+            bool isBetter(PricePolicy policy, const node_t *candidate, const node_t *current) const {
+                return policy == PricePolicy::Min
+                    ? bounds.of(candidate).min < bounds.of(current).min
+                    : bounds.of(current).max < bounds.of(candidate).max;
+            }
+
+            std::shared_ptr<const layout_t> layout;
+            PriceBounds<Key, Value> bounds;
+        };
+
+        /** Возвращает самое дешёвое решение дерева source (см. PriceExtremes). */
+        template <typename Key, typename Value>
+        SolutionView<Key, Value> cheapestSolution(const AndOrTree<Key, Value> &source) {
+            return PriceExtremes<Key, Value>(source).cheapest();
+        }
+
+        /** Возвращает самое дорогое решение дерева source (см. PriceExtremes). */
+        template <typename Key, typename Value>
+        SolutionView<Key, Value> mostExpensiveSolution(const AndOrTree<Key, Value> &source) {
+            return PriceExtremes<Key, Value>(source).mostExpensive();
+        }
+    }
+}
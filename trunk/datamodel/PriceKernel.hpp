@@ -0,0 +1,266 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <cstdint>
+#include <vector>
+
+// вариант с AVX2 компилируется без ключей /arch и -mavx2 и выбирается
+// во время выполнения (\see hasAvx2()); 32-разрядная сборка VS2012
+// не поддерживает часть 64-битных команд, поэтому в ней вариант отключён
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#define VEHICLE_HAS_AVX2 1
+#define VEHICLE_TARGET_AVX2
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <immintrin.h>
+#define VEHICLE_HAS_AVX2 1
+#define VEHICLE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /**
+         * Перевод стоимости в целое число минимальных единиц (копеек) и обратно.
+         * По умолчанию используется внутреннее представление decimal
+         * (getUnbiased()/setUnbiased()), сложение в котором точное;
+         * для других типов ключа шаблон специализируется.
+         */
+        template <typename Key>
+        struct PriceUnits {
+            static int64_t of(const Key &price) { return price.getUnbiased(); }
+            static Key from(int64_t units) {
+                Key price;
+                price.setUnbiased(units);
+                return price;
+            }
+        };
+
+        /**
+         * Значение "поддерживают ли процессор и операционная система
+         * команды AVX2?": бит 5 EBX функции 7 CPUID, а также OSXSAVE
+         * и сохранение регистров YMM операционной системой (XGETBV).
+         */
+        inline bool hasAvx2() {
+#if defined(VEHICLE_HAS_AVX2) && defined(_MSC_VER)
+            int registers[4];
+            __cpuid(registers, 0);
+            if (registers[0] < 7) { return false; }
+            __cpuid(registers, 1);
+            const int osxsave = 1 << 27, avx = 1 << 28;
+            if ((registers[2] & (osxsave | avx)) != (osxsave | avx)) { return false; }
+            // состояние XMM и YMM сохраняется операционной системой
+            if ((_xgetbv(0) & 6) != 6) { return false; }
+            __cpuidex(registers, 7, 0);
+            return (registers[1] & (1 << 5)) != 0;
+#elif defined(VEHICLE_HAS_AVX2)
+            // проверяет и CPUID, и XGETBV
+            return __builtin_cpu_supports("avx2") != 0;
+#else
+            return false;
+#endif
+        }
+
+        /**
+         * Пакет решений для PriceKernel: индексы выбранных альтернатив
+         * (см. SolutionView::choiceIndices()) хранятся по столбцам
+         * - отдельный массив на разряд, чтобы индексы одного разряда
+         * соседних решений загружались одной командой.
+         */
+        class PriceBatch {
+        public:
+            explicit PriceBatch(size_t slotCount): columns(slotCount), count(0) {}
+
+            /** Добавляет решение: индексы выбранных альтернатив по разрядам. */
+            void add(const std::vector<size_t> &choices) {
+                assert(choices.size() == columns.size());
+                for (size_t slot = 0; slot < columns.size(); slot++) {
+                    columns[slot].push_back((int32_t)choices[slot]);
+                }
+                count++;
+            }
+
+            void clear() {
+                for (auto &column : columns) { column.clear(); }
+                count = 0;
+            }
+
+            /** Возвращает количество решений в пакете. */
+            size_t size() const { return count; }
+
+            size_t slotCount() const { return columns.size(); }
+
+            /** Возвращает индексы альтернатив разряда slot для всех решений пакета. */
+            const int32_t * column(size_t slot) const { return columns[slot].data(); }
+
+        private:
+            std::vector<std::vector<int32_t>> columns;
+            size_t count;
+        };
+
+        /**
+         * Расчёт стоимостей пакета решений без обхода дерева.
+         * Дерево разворачивается в плоскую таблицу целых стоимостей
+         * (PriceUnits): базовая стоимость - ключи узлов, входящих
+         * в любое решение, и по строке на альтернативу каждого разряда
+         * - ключи узлов, входящих в решение вместе с этой альтернативой
+         * до вложенных разрядов выбора. Стоимость решения - базовая
+         * стоимость плюс строки выбранных альтернатив активных разрядов.
+         * Если процессор поддерживает AVX2 (проверяется при создании),
+         * решения обрабатываются по четыре: строки выбираются из таблицы
+         * командой gather с маской активности разряда; иначе
+         * используется скалярный вариант. Сложение
+         * целое, поэтому оба варианта дают в точности ту же стоимость,
+         * что и сложение ключей при обходе дерева решения.
+         * Таблица зависит от ключей и структуры дерева (но не от
+         * зафиксированных узлов) и строится заново при их изменении.
+         */
+        template <typename Key, typename Value>
+        class PriceKernel {
+        public:
+            typedef Node<Key, Value> node_t;
+            typedef ChoiceLayout<Key, Value> layout_t;
+
+            explicit PriceKernel(const layout_t &layout): base(0), avx2(hasAvx2()) {
+                size_t count = layout.size();
+                offsets.resize(count + 1, 0);
+                parents.resize(count);
+                branches.resize(count);
+                if (layout.root()) { collect(layout.root(), base); }
+                for (size_t slot = 0; slot < count; slot++) {
+                    const node_t *node = layout.node(slot);
+                    size_t parent = layout.parent(slot);
+                    parents[slot] = parent == layout_t::npos ? -1 : (int32_t)parent;
+                    branches[slot] = (int32_t)layout.branch(slot);
+                    offsets[slot] = (int32_t)prices.size();
+                    for (auto child : *node) {
+                        int64_t price = 0;
+                        collect(child, price);
+                        prices.push_back(price);
+                    }
+                    assert(prices.size() < (size_t)INT32_MAX);
+                }
+                offsets[count] = (int32_t)prices.size();
+            }
+
+            /** Возвращает количество разрядов выбора. */
+            size_t slotCount() const { return parents.size(); }
+
+            /** Возвращает стоимость узлов, входящих в любое решение. */
+            int64_t basePrice() const { return base; }
+
+            /**
+             * Рассчитывает стоимости решений пакета batch в totals
+             * (batch.size() значений, в единицах PriceUnits).
+             */
+            void evaluate(const PriceBatch &batch, int64_t *totals) const {
+                assert(batch.slotCount() == slotCount());
+#ifdef VEHICLE_HAS_AVX2
+                if (avx2) {
+                    size_t vectorized = batch.size() / 4 * 4;
+                    evaluateAvx2(batch, vectorized, totals);
+                    evaluateScalar(batch, vectorized, batch.size(), totals);
+                    return;
+                }
+#endif
+                evaluateScalar(batch, 0, batch.size(), totals);
+            }
+
+            /** Скалярный вариант evaluate(). */
+            void evaluateScalar(const PriceBatch &batch, int64_t *totals) const {
+                assert(batch.slotCount() == slotCount());
+                evaluateScalar(batch, 0, batch.size(), totals);
+            }
+
+            /** Возвращает стоимости решений пакета batch. */
+            std::vector<Key> evaluate(const PriceBatch &batch) const {
+                std::vector<int64_t> totals(batch.size());
+                if (!totals.empty()) { evaluate(batch, &totals[0]); }
+                std::vector<Key> result;
+                result.reserve(totals.size());
+                for (int64_t total : totals) {
+                    result.push_back(PriceUnits<Key>::from(total));
+                }
+                return result;
+            }
+
+        private:
+            /** Суммирует ключи узлов поддерева node до вложенных разрядов выбора. */
+            static void collect(const node_t *node, int64_t &price) {
+                price += PriceUnits<Key>::of(node->ownKey());
+                if (hasChoice(node)) { return; }
+                for (auto child : *node) {
+                    collect(child, price);
+                }
+            }
+
+            void evaluateScalar(const PriceBatch &batch, size_t begin, size_t end, int64_t *totals) const {
+                // разряды упорядочены от охватывающих к вложенным,
+                // поэтому активность родителя известна к началу разряда
+                std::vector<char> active(slotCount());
+                for (size_t b = begin; b < end; b++) {
+                    int64_t total = base;
+                    for (size_t slot = 0; slot < slotCount(); slot++) {
+                        int32_t parent = parents[slot];
+                        active[slot] = parent < 0 ||
+                            (active[parent] && batch.column(parent)[b] == branches[slot]);
+                        if (active[slot]) {
+                            int32_t index = offsets[slot] + batch.column(slot)[b];
+                            assert(index >= offsets[slot] && index < offsets[slot + 1]);
+                            total += prices[index];
+                        }
+                    }
+                    totals[b] = total;
+                }
+            }
+
+#ifdef VEHICLE_HAS_AVX2
+            /** Рассчитывает стоимости решений [0, end) по четыре; end кратно 4. */
+            VEHICLE_TARGET_AVX2 void evaluateAvx2(const PriceBatch &batch, size_t end, int64_t *totals) const {
+                const long long *table = reinterpret_cast<const long long *>(prices.data());
+                // маски активности разрядов для текущих четырёх решений
+                std::vector<int64_t> masks(slotCount() * 4);
+                const __m256i all = _mm256_set1_epi64x(-1);
+                for (size_t b = 0; b < end; b += 4) {
+                    __m256i total = _mm256_set1_epi64x(base);
+                    for (size_t slot = 0; slot < slotCount(); slot++) {
+                        int32_t parent = parents[slot];
+                        __m256i mask = all;
+                        if (parent >= 0) {
+                            __m128i parentChoices = _mm_loadu_si128(
+                                reinterpret_cast<const __m128i *>(batch.column(parent) + b));
+                            __m128i same = _mm_cmpeq_epi32(parentChoices, _mm_set1_epi32(branches[slot]));
+                            mask = _mm256_and_si256(
+                                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&masks[parent * 4])),
+                                _mm256_cvtepi32_epi64(same));
+                        }
+                        _mm256_storeu_si256(reinterpret_cast<__m256i *>(&masks[slot * 4]), mask);
+                        if (_mm256_testz_si256(mask, mask)) { continue; }
+                        __m128i index = _mm_add_epi32(
+                            _mm_loadu_si128(reinterpret_cast<const __m128i *>(batch.column(slot) + b)),
+                            _mm_set1_epi32(offsets[slot]));
+                        __m256i price = _mm256_mask_i32gather_epi64(_mm256_setzero_si256(), table, index, mask, 8);
+                        total = _mm256_add_epi64(total, price);
+                    }
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(totals + b), total);
+                }
+            }
+#endif
+
+            int64_t base;
+            /** Значение "используется ли вариант с AVX2?" */
+            bool avx2;
+            /** Строки альтернатив разряда занимают в prices диапазон [offsets[slot], offsets[slot + 1]). */
+            std::vector<int32_t> offsets;
+            std::vector<int64_t> prices;
+            /** Ближайший охватывающий разряд (-1 для верхних) и ветвь, ведущая к разряду. */
+            std::vector<int32_t> parents;
+            std::vector<int32_t> branches;
+        };
+    }
+}
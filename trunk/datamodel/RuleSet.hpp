@@ -0,0 +1,419 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /** Вид правила совместимости. */
+        enum class RuleKind {
+            /** Если в решение входит first, то в него входит и second. */
+            Requires,
+            /** first и second не входят в решение одновременно. */
+            Excludes
+        };
+
+        /**
+         * Набор правил совместимости между узлами исходного дерева
+         * (как правило, альтернативами разных ИЛИ-узлов), которые не
+         * выражаются структурой И-ИЛИ дерева: "B&O требует полного
+         * электропакета", "450 л.с. недоступны с дизелем".
+         * Узел входит в решение, если на пути к нему от корня в каждом
+         * узле выбора выбрана ветвь, ведущая к нему.
+         * Правила ссылаются на узлы исходного дерева, поэтому набор правил
+         * действителен, пока узлы не удалены.
+         */
+        template <typename Key, typename Value>
+        class RuleSet {
+        public:
+            typedef Node<Key, Value> node_t;
+
+            struct Rule {
+                Rule(RuleKind kind, const node_t *first, const node_t *second):
+                    kind(kind), first(first), second(second) {}
+                RuleKind kind;
+                const node_t *first;
+                const node_t *second;
+            };
+
+            /** Добавляет правило "first требует second". */
+            void require(const node_t *first, const node_t *second) {
+                assert(first && second);
+                ruleList.push_back(Rule(RuleKind::Requires, first, second));
+            }
+
+            /** Добавляет правило "first и second несовместимы". */
+            void exclude(const node_t *first, const node_t *second) {
+                assert(first && second);
+                ruleList.push_back(Rule(RuleKind::Excludes, first, second));
+            }
+
+            const std::vector<Rule> & rules() const { return ruleList; }
+
+            bool empty() const { return ruleList.empty(); }
+
+        private:
+            std::vector<Rule> ruleList;
+        };
+
+        /**
+         * Набор правил, привязанный к разметке разрядов выбора (ChoiceLayout):
+         * каждый узел правила заменяется цепочкой условий "разряд - ветвь"
+         * от корня, а правила индексируются по разрядам своих цепочек.
+         * Это позволяет проверять правила при переборе разрядов по порядку
+         * разметки: как только выбор в разряде делает правило нарушенным
+         * при любом продолжении, альтернатива отсекается вместе со всем
+         * своим поддеревом.
+         * При построении допустимые альтернативы разрядов (с учётом
+         * зафиксированных узлов) сужаются распространением правил до
+         * неподвижной точки: если узел правила входит в любое решение
+         * или не входит ни в одно, правило превращается в запрет или
+         * требование альтернатив отдельных разрядов, а разряд без
+         * допустимых альтернатив запрещает ведущую к нему ветвь.
+         * Правила, выполненные при любом выборе, после этого
+         * не проверяются и не делают разряды значимыми (isRelevant()).
+         */
+        template <typename Key, typename Value>
+        class CompiledRules {
+        public:
+            typedef Node<Key, Value> node_t;
+            typedef ChoiceLayout<Key, Value> layout_t;
+            typedef RuleSet<Key, Value> rules_t;
+
+            CompiledRules(const rules_t &source, const layout_t &layout):
+                allowed(layout.size()),
+                allowedCounts(layout.size(), 0),
+                slotRules(layout.size()),
+                relevantSlots(layout.size(), false),
+                alwaysViolated(false)
+            {
+                std::unordered_map<const node_t *, size_t> literals;
+                for (auto &rule : source.rules()) {
+                    literals.insert(std::make_pair(rule.first, literals.size()));
+                    literals.insert(std::make_pair(rule.second, literals.size()));
+                }
+                chains.resize(literals.size());
+                std::vector<std::pair<size_t, size_t>> path;
+                if (layout.root()) { collect(layout.root(), layout, literals, path); }
+
+                for (auto &rule : source.rules()) {
+                    rules.push_back(CompiledRule(rule.kind, literals[rule.first], literals[rule.second]));
+                }
+
+                for (size_t slot = 0; slot < layout.size(); slot++) {
+                    const node_t *node = layout.node(slot);
+                    size_t fixed = fixedChildIndex(node);
+                    allowed[slot].assign(node->childCount(), fixed == node->childCount());
+                    if (fixed != node->childCount()) { allowed[slot][fixed] = true; }
+                    allowedCounts[slot] = fixed == node->childCount() ? node->childCount() : 1;
+                }
+                propagate(layout);
+                if (alwaysViolated) { return; }
+
+                for (size_t r = 0; r < rules.size(); r++) {
+                    if (isEntailed(rules[r])) { continue; }
+                    // правило проверяется в каждом разряде своих цепочек
+                    std::vector<size_t> slots;
+                    for (auto &condition : chains[rules[r].first]) { slots.push_back(condition.first); }
+                    for (auto &condition : chains[rules[r].second]) { slots.push_back(condition.first); }
+                    std::sort(slots.begin(), slots.end());
+                    slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+                    for (size_t slot : slots) {
+                        slotRules[slot].push_back(r);
+                        relevantSlots[slot] = true;
+                    }
+                }
+            }
+
+            bool empty() const { return rules.empty(); }
+
+            /**
+             * Значение "нарушено ли правило при любом выборе?"
+             * (например, исключение двух узлов, входящих в любое решение,
+             * или противоречие, найденное распространением правил);
+             * в этом случае допустимых решений нет.
+             */
+            bool isAlwaysViolated() const { return alwaysViolated; }
+
+            /**
+             * Значение "влияет ли выбор в разряде на выполнение правил?"
+             * (разряд входит в цепочку условий хотя бы одного узла правил).
+             */
+            bool isRelevant(size_t slot) const { return relevantSlots.at(slot); }
+
+            /**
+             * Значение "может ли альтернатива index разряда slot входить
+             * в решение, удовлетворяющее правилам?" по результатам
+             * распространения правил.
+             */
+            bool isAllowed(size_t slot, size_t index) const { return allowed[slot][index]; }
+
+            /**
+             * Значение "не нарушено ли ни одно из правил, зависящих
+             * от разряда slot?", если выбор сделан в разрядах [0, slot].
+             * Правило считается нарушенным, только если оно нарушается
+             * при любом выборе в остальных разрядах; альтернатива,
+             * исключённая распространением правил, тоже отсекается.
+             */
+            bool isConsistent(const std::vector<size_t> &choices, size_t slot) const {
+                if (!allowed[slot][choices[slot]]) { return false; }
+                for (size_t r : slotRules[slot]) {
+                    if (isViolated(rules[r], choices, slot)) { return false; }
+                }
+                return true;
+            }
+
+            /** Значение "выполнены ли все правила в полном решении?" */
+            bool isSatisfied(const std::vector<size_t> &choices) const {
+                size_t last = choices.size() - 1;
+                for (auto &rule : rules) {
+                    if (isViolated(rule, choices, last)) { return false; }
+                }
+                return true;
+            }
+
+        private:
+            enum Truth { False, True, Unknown };
+
+            struct CompiledRule {
+                CompiledRule(RuleKind kind, size_t first, size_t second):
+                    kind(kind), first(first), second(second) {}
+                RuleKind kind;
+                size_t first;
+                size_t second;
+            };
+
+            /**
+             * Собирает цепочки условий (разряд, ветвь) для узлов правил.
+             * @param path условия на пути от корня к узлу node
+             */
+            void collect(const node_t *node, const layout_t &layout,
+                         const std::unordered_map<const node_t *, size_t> &literals,
+                         std::vector<std::pair<size_t, size_t>> &path)
+            {
+                auto it = literals.find(node);
+                if (it != literals.end()) { chains[it->second] = path; }
+                size_t slot = layout.slotOf(node);
+                for (size_t i = 0; i < node->childCount(); i++) {
+                    if (slot != layout_t::npos) { path.push_back(std::make_pair(slot, i)); }
+                    collect(node->child(i), layout, literals, path);
+                    if (slot != layout_t::npos) { path.pop_back(); }
+                }
+            }
+
+            /** Входит ли узел literal в решение, если выбор сделан в разрядах [0, decided]. */
+            Truth evaluate(size_t literal, const std::vector<size_t> &choices, size_t decided) const {
+                for (auto &condition : chains[literal]) {
+                    if (condition.first > decided) { return Unknown; }
+                    if (choices[condition.first] != condition.second) { return False; }
+                }
+                return True;
+            }
+
+            bool isViolated(const CompiledRule &rule, const std::vector<size_t> &choices, size_t decided) const {
+                Truth first = evaluate(rule.first, choices, decided);
+                if (first != True) { return false; }
+                Truth second = evaluate(rule.second, choices, decided);
+                return rule.kind == RuleKind::Requires ? second == False : second == True;
+            }
+
+            /**
+             * Входит ли узел literal в решения с учётом допустимых альтернатив:
+             * True - в любое, False - ни в одно, Unknown - зависит от выбора.
+             */
+            Truth status(size_t literal) const {
+                Truth result = True;
+                for (auto &condition : chains[literal]) {
+                    if (!allowed[condition.first][condition.second]) { return False; }
+                    if (allowedCounts[condition.first] > 1) { result = Unknown; }
+                }
+                return result;
+            }
+
+            /** Значение "выполнено ли правило при любом допустимом выборе?" */
+            bool isEntailed(const CompiledRule &rule) const {
+                Truth first = status(rule.first);
+                if (first == False) { return true; }
+                Truth second = status(rule.second);
+                return rule.kind == RuleKind::Requires ? second == True : second == False;
+            }
+
+            /** Запрещает альтернативу; возвращает true, если она была допустима. */
+            bool disallow(size_t slot, size_t index) {
+                if (!allowed[slot][index]) { return false; }
+                allowed[slot][index] = false;
+                allowedCounts[slot]--;
+                return true;
+            }
+
+            /**
+             * Исключает узел literal из решений: если выбор не определён
+             * только в одном разряде его цепочки, ведущая к узлу ветвь
+             * этого разряда запрещается (остальные разряды цепочки входят
+             * в решение вместе с ним). Возвращает true, если допустимые
+             * альтернативы сузились.
+             */
+            bool forbid(size_t literal) {
+                auto &chain = chains[literal];
+                size_t open = chain.size();
+                size_t openCount = 0;
+                for (size_t i = 0; i < chain.size(); i++) {
+                    if (!allowed[chain[i].first][chain[i].second]) { return false; }
+                    if (allowedCounts[chain[i].first] > 1) {
+                        open = i;
+                        openCount++;
+                    }
+                }
+                if (openCount == 0) {
+                    // узел входит в любое решение
+                    alwaysViolated = true;
+                    return false;
+                }
+                return openCount == 1 && disallow(chain[open].first, chain[open].second);
+            }
+
+            /**
+             * Включает узел literal в любое решение: в разрядах его цепочки
+             * остаются только ведущие к нему ветви. Возвращает true,
+             * если допустимые альтернативы сузились.
+             */
+            bool require(size_t literal) {
+                bool changed = false;
+                for (auto &condition : chains[literal]) {
+                    if (!allowed[condition.first][condition.second]) {
+                        alwaysViolated = true;
+                        return false;
+                    }
+                    for (size_t i = 0; i < allowed[condition.first].size(); i++) {
+                        if (i != condition.second && disallow(condition.first, i)) { changed = true; }
+                    }
+                }
+                return changed;
+            }
+
+            /** Сужает допустимые альтернативы разрядов до неподвижной точки. */
+            void propagate(const layout_t &layout) {
+                bool changed = true;
+                while (changed && !alwaysViolated) {
+                    changed = false;
+                    for (auto &rule : rules) {
+                        Truth first = status(rule.first);
+                        Truth second = status(rule.second);
+                        if (rule.kind == RuleKind::Requires) {
+                            if (first == True && require(rule.second)) { changed = true; }
+                            if (second == False && forbid(rule.first)) { changed = true; }
+                        } else {
+                            if (first == True && forbid(rule.second)) { changed = true; }
+                            if (second == True && forbid(rule.first)) { changed = true; }
+                        }
+                    }
+                    // вложенные разряды имеют большие номера, поэтому
+                    // запрет ветвей поднимается к корню за один проход
+                    for (size_t slot = layout.size(); slot-- > 0 && !alwaysViolated;) {
+                        if (allowedCounts[slot] > 0) { continue; }
+                        size_t parent = layout.parent(slot);
+                        if (parent == layout_t::npos) {
+                            alwaysViolated = true;
+                        } else if (disallow(parent, layout.branch(slot))) {
+                            changed = true;
+                        }
+                    }
+                }
+            }
+
+            std::vector<CompiledRule> rules;
+            /** Цепочки условий (разряд, ветвь) узлов правил в порядке разрядов. */
+            std::vector<std::vector<std::pair<size_t, size_t>>> chains;
+            /** Допустимые альтернативы разрядов после распространения правил. */
+            std::vector<std::vector<bool>> allowed;
+            std::vector<size_t> allowedCounts;
+            /** Правила, зависящие от разряда (кроме выполненных при любом выборе). */
+            std::vector<std::vector<size_t>> slotRules;
+            std::vector<bool> relevantSlots;
+            bool alwaysViolated;
+        };
+
+        /**
+         * Возвращает точное количество решений дерева source (с учётом
+         * зафиксированных узлов), удовлетворяющих правилам rules.
+         * Перебираются только разряды, влияющие на оставшиеся после
+         * распространения правил ограничения (и охватывающие их);
+         * количества решений поддеревьев остальных разрядов с учётом
+         * допустимых альтернатив рассчитываются динамическим
+         * программированием снизу вверх и учитываются множителем.
+         */
+        template <typename Key, typename Value>
+        size_t countSolutions(const AndOrTree<Key, Value> &source, const RuleSet<Key, Value> &rules) {
+            typedef Node<Key, Value> node_t;
+            typedef ChoiceLayout<Key, Value> layout_t;
+
+            struct Counter {
+                Counter(const node_t *root, const RuleSet<Key, Value> &source):
+                    layout(root),
+                    rules(source, layout),
+                    choices(layout.size(), 0),
+                    powers(layout.size(), 0),
+                    relevant(layout.size(), false)
+                {
+                    // вложенные разряды имеют большие номера и рассчитываются раньше
+                    for (size_t slot = layout.size(); slot-- > 0;) {
+                        const node_t *node = layout.node(slot);
+                        for (size_t i = 0; i < node->childCount(); i++) {
+                            if (rules.isAllowed(slot, i)) { powers[slot] += power(node->child(i)); }
+                        }
+                    }
+                    // разряд перебирается, если он или его потомок влияет на правила
+                    for (size_t slot = layout.size(); slot-- > 0;) {
+                        if (rules.isRelevant(slot)) {
+                            for (size_t p = slot; p != layout_t::npos && !relevant[p]; p = layout.parent(p)) {
+                                relevant[p] = true;
+                            }
+                        }
+                    }
+                }
+
+                /** Количество решений поддерева узла; для узлов выбора - из powers. */
+                size_t power(const node_t *node) const {
+                    if (hasChoice(node)) { return powers[layout.slotOf(node)]; }
+                    size_t product = 1;
+                    for (auto child : *node) { product *= power(child); }
+                    return product;
+                }
+
+                size_t count(size_t slot) {
+                    while (slot < layout.size() && !layout.isActive(choices, slot)) {
+                        slot = layout.end(slot);
+                    }
+                    if (slot == layout.size()) { return 1; }
+                    if (!relevant[slot]) {
+                        return powers[slot] * count(layout.end(slot));
+                    }
+                    size_t total = 0;
+                    for (size_t i = 0; i < layout.node(slot)->childCount(); i++) {
+                        choices[slot] = i;
+                        if (rules.isConsistent(choices, slot)) { total += count(slot + 1); }
+                    }
+                    return total;
+                }
+
+                layout_t layout;
+                CompiledRules<Key, Value> rules;
+                std::vector<size_t> choices;
+                std::vector<size_t> powers;
+                std::vector<bool> relevant;
+            };
+
+            if (!source.getRoot()) { return 0; }
+            Counter counter(source.getRoot(), rules);
+            return counter.rules.isAlwaysViolated() ? 0 : counter.count(0);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,200 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "ChoiceLayout.hpp"
+#include "RuleSet.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /**
+         * Выбор альтернатив по разрядам ChoiceLayout с учётом зафиксированных
+         * узлов - общая часть поиска с отсечениями (BranchAndBoundIterator,
+         * ClosestPriceSearch, BestValueSearch); сами поиски отвечают
+         * только за границы и отбор решений.
+         * Хранит выбранные индексы разрядов и значения "участвует ли разряд
+         * в текущем решении?"; значение для разряда получается из значения
+         * охватывающего разряда за O(1), в отличие от
+         * ChoiceLayout::isActive(), который поднимается до корня.
+         * Данные поиска о детях разрядов (границы стоимости, баллы)
+         * хранятся в общих массивах по номеру offset(slot) + индекс ребёнка.
+         */
+        template <typename Key, typename Value>
+        class SlotWalker {
+        public:
+            typedef ChoiceLayout<Key, Value> layout_t;
+            typedef Node<Key, Value> node_t;
+            typedef CompiledRules<Key, Value> rules_t;
+
+            explicit SlotWalker(std::shared_ptr<const layout_t> layout): layout(std::move(layout)) {
+                size_t slots = this->layout->size();
+                fixed.resize(slots);
+                offsets.resize(slots + 1, 0);
+                for (size_t slot = 0; slot < slots; slot++) {
+                    const node_t *node = this->layout->node(slot);
+                    fixed[slot] = fixedChildIndex(node);
+                    offsets[slot + 1] = offsets[slot] + node->childCount();
+                }
+                choices.resize(slots);
+                for (size_t slot = 0; slot < slots; slot++) {
+                    choices[slot] = firstAlternative(slot);
+                }
+                active.assign(slots, false);
+            }
+
+            /** Возвращает количество разрядов. */
+            size_t size() const { return choices.size(); }
+
+            const layout_t & choiceLayout() const { return *layout; }
+
+            /** Возвращает номер первого ребёнка разряда в общих массивах детей. */
+            size_t offset(size_t slot) const { return offsets[slot]; }
+
+            /** Возвращает общее количество детей всех разрядов. */
+            size_t childTotal() const { return offsets.back(); }
+
+            size_t childCount(size_t slot) const { return offsets[slot + 1] - offsets[slot]; }
+
+            /** Значение "не зафиксирован ли ни один ребёнок разряда?" */
+            bool isFree(size_t slot) const { return fixed[slot] == childCount(slot); }
+
+            /** Возвращает первую допустимую альтернативу разряда. */
+            size_t firstAlternative(size_t slot) const { return isFree(slot) ? 0 : fixed[slot]; }
+
+            /** Возвращает альтернативу, следующую за последней допустимой. */
+            size_t endAlternative(size_t slot) const { return isFree(slot) ? childCount(slot) : fixed[slot] + 1; }
+
+            /** Выбранные индексы разрядов (по одному на разряд). */
+            const std::vector<size_t> & choiceIndices() const { return choices; }
+
+            size_t choice(size_t slot) const { return choices[slot]; }
+
+            void choose(size_t slot, size_t index) { choices[slot] = index; }
+
+            /** Значение "участвует ли разряд в текущем решении?" по последнему activate(). */
+            bool wasActive(size_t slot) const { return active[slot]; }
+
+            /**
+             * Определяет, участвует ли разряд в решении при выборе
+             * в охватывающих разрядах, и возвращает это значение.
+             * Неактивному разряду назначается первая допустимая альтернатива.
+             */
+            bool activate(size_t slot) {
+                size_t parent = layout->parent(slot);
+                active[slot] = parent == layout_t::npos ||
+                    (active[parent] && choices[parent] == layout->branch(slot));
+                if (!active[slot]) { choices[slot] = firstAlternative(slot); }
+                return active[slot];
+            }
+
+            /**
+             * Перебирает в глубину выбор в разрядах [slot, size()) в порядке
+             * перебора SolutionIterator. Search должен предоставлять:
+             *  - bool enter(slot, index) - для допустимой альтернативы index
+             *    разряда, участвующего в решении: рассчитывает границы поиска
+             *    после разряда; false - альтернатива отсекается вместе
+             *    с продолжениями;
+             *  - void skip(slot, end) - разряды [slot, end) не участвуют
+             *    в решении, границы после end равны границам до slot;
+             *  - void complete() - выбор сделан во всех разрядах (choiceIndices()).
+             * Альтернативы, нарушающие правила rules (если заданы), отсекаются.
+             */
+            template <typename Search>
+            void walk(Search &search, const rules_t *rules, size_t slot = 0) {
+                // неактивный разряд исключает из решения и все вложенные разряды
+                while (slot < size() && !activate(slot)) {
+                    size_t end = layout->end(slot);
+                    for (size_t s = slot + 1; s < end; s++) {
+                        active[s] = false;
+                        choices[s] = firstAlternative(s);
+                    }
+                    search.skip(slot, end);
+                    slot = end;
+                }
+                if (slot == size()) {
+                    search.complete();
+                    return;
+                }
+                size_t first = firstAlternative(slot);
+                for (size_t i = first; i < endAlternative(slot); i++) {
+                    if (!search.enter(slot, i)) { continue; }
+                    choices[slot] = i;
+                    if (rules && !rules->isConsistent(choices, slot)) { continue; }
+                    walk(search, rules, slot + 1);
+                }
+                choices[slot] = first;
+            }
+
+        private:
+            std::shared_ptr<const layout_t> layout;
+            /** Индекс зафиксированного ребёнка разряда (или количество детей). */
+            std::vector<size_t> fixed;
+            /** Начало детей разряда в общих массивах детей. */
+            std::vector<size_t> offsets;
+            std::vector<size_t> choices;
+            std::vector<bool> active;
+        };
+
+        /**
+         * Не более count лучших решений поиска с отсечениями: куча,
+         * в вершине которой - худшее из них. Candidate должен иметь поле
+         * sequence (номер в порядке поступления, назначается при push())
+         * и метод isBetterThan(other), сравнивающий по sequence при
+         * равенстве остальных критериев, т.е. результат не зависит
+         * от порядка отсечений.
+         */
+        template <typename Candidate>
+        class BestCandidates {
+        public:
+            BestCandidates(): count(0), sequence(0) {}
+
+            /** Очищает набор и задаёт наибольшее количество решений. */
+            void reset(size_t count) {
+                this->count = count;
+                heap.clear();
+                sequence = 0;
+            }
+
+            bool isFull() const { return heap.size() >= count; }
+
+            /** Возвращает худшее из решений; набор не должен быть пуст. */
+            const Candidate & worst() const { return heap.front(); }
+
+            /**
+             * Добавляет решение, вытесняя худшее, если набор полон;
+             * решение должно быть лучше worst() (проверяется вызывающим).
+             */
+            void push(Candidate candidate) {
+                assert(count > 0);
+                candidate.sequence = sequence++;
+                if (isFull()) {
+                    std::pop_heap(heap.begin(), heap.end(), &isBetter);
+                    heap.pop_back();
+                }
+                heap.push_back(std::move(candidate));
+                std::push_heap(heap.begin(), heap.end(), &isBetter);
+            }
+
+            /** Возвращает решения от лучшего к худшему и очищает набор. */
+            std::vector<Candidate> take() {
+                std::sort(heap.begin(), heap.end(), &isBetter);
+                std::vector<Candidate> result;
+                result.swap(heap);
+                return result;
+            }
+
+        private:
+            static bool isBetter(const Candidate &a, const Candidate &b) { return a.isBetterThan(b); }
+
+            size_t count;
+            size_t sequence;
+            std::vector<Candidate> heap;
+        };
+    }
+}
@@ -0,0 +1,360 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+#include "SolutionView.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /**
+         * Возвращает зафиксированные узлы дерева разметки layout:
+         * индекс зафиксированного ребёнка каждого разряда
+         * (или количество детей, если ребёнок не зафиксирован).
+         */
+        template <typename Key, typename Value>
+        std::vector<size_t> fixedState(const ChoiceLayout<Key, Value> &layout) {
+            std::vector<size_t> state(layout.size());
+            for (size_t slot = 0; slot < state.size(); slot++) {
+                state[slot] = fixedChildIndex(layout.node(slot));
+            }
+            return state;
+        }
+
+        /**
+         * Подпространство решений: решения, в которых в каждом активном
+         * разряде выбрана допустимая альтернатива. Допустимые альтернативы
+         * задаются состоянием зафиксированных узлов (base) и небольшим
+         * числом уточнений для отдельных разрядов, поэтому размер
+         * подпространства в памяти не зависит от размера дерева.
+         * Уточнения нормализованы: разряд без допустимых альтернатив
+         * исключается запретом ведущей к нему ветви охватывающего разряда,
+         * т.е. при переборе тупиков не бывает.
+         */
+        template <typename Key, typename Value>
+        class Subspace {
+        public:
+            typedef ChoiceLayout<Key, Value> layout_t;
+            typedef Node<Key, Value> node_t;
+            typedef std::map<size_t, std::vector<bool>> constraints_t;
+
+            Subspace(std::shared_ptr<const layout_t> layout,
+                     std::shared_ptr<const std::vector<size_t>> base,
+                     constraints_t constraints):
+                layoutPtr(std::move(layout)),
+                base(std::move(base)),
+                overrides(std::move(constraints))
+            {}
+
+            const std::shared_ptr<const layout_t> & layout() const { return layoutPtr; }
+
+            /** Уточнения допустимых альтернатив по разрядам. */
+            const constraints_t & constraints() const { return overrides; }
+
+            /** Значение "допустима ли альтернатива i разряда slot?" */
+            bool isAllowed(size_t slot, size_t i) const {
+                auto found = overrides.find(slot);
+                if (found != overrides.end()) { return found->second[i]; }
+                size_t fixed = (*base)[slot];
+                return fixed == layoutPtr->node(slot)->childCount() || fixed == i;
+            }
+
+            /** Возвращает количество решений подпространства (за O(n)). */
+            uint64_t count() const {
+                return layoutPtr->root() ? count(layoutPtr->root()) : 0;
+            }
+
+        private:
+            uint64_t count(const node_t *node) const {
+                if (hasChoice(node)) {
+                    size_t slot = layoutPtr->slotOf(node);
+                    uint64_t total = 0;
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        if (isAllowed(slot, i)) { total += count(node->child(i)); }
+                    }
+                    return total;
+                }
+                uint64_t total = 1;
+                for (auto child : *node) {
+                    total *= count(child);
+                }
+                return total;
+            }
+
+            std::shared_ptr<const layout_t> layoutPtr;
+            std::shared_ptr<const std::vector<size_t>> base;
+            constraints_t overrides;
+        };
+
+        /**
+         * Перебор решений подпространства в порядке SolutionIterator.
+         * Интерфейс совпадает с итераторами решений, поэтому подходит
+         * для streamSolutions() и solutionViews().
+         */
+        template <typename Key, typename Value>
+        class SubspaceIterator {
+        public:
+            typedef Subspace<Key, Value> subspace_t;
+            typedef ChoiceLayout<Key, Value> layout_t;
+            typedef Node<Key, Value> node_t;
+            typedef SolutionView<Key, Value> view_t;
+
+            explicit SubspaceIterator(const subspace_t &subspace):
+                subspace(subspace),
+                layout(subspace.layout()),
+                choices(layout->size(), 0),
+                active(layout->size(), false),
+                exists(layout->root() != nullptr)
+            {
+                reset(0);
+                // верхние разряды активны всегда
+                for (size_t slot = 0; exists && slot < choices.size(); slot++) {
+                    if (active[slot] && !hasAllowed(slot)) { exists = false; }
+                }
+            }
+
+            bool hasSolution() const { return exists; }
+
+            view_t currentView() const {
+                assert(hasSolution());
+                view_t view(layout, choices, Key());
+                Key price = Key();
+                view.walk([&price] (const node_t *node) { price = price + node->ownKey(); });
+                return view_t(layout, choices, price);
+            }
+
+            /** Переходит к следующему решению; возвращает false, если решения закончились. */
+            bool nextSolution() {
+                for (size_t slot = choices.size(); exists && slot-- > 0;) {
+                    if (!active[slot]) { continue; }
+                    size_t count = layout->node(slot)->childCount();
+                    for (size_t i = choices[slot] + 1; i < count; i++) {
+                        if (subspace.isAllowed(slot, i)) {
+                            choices[slot] = i;
+                            reset(slot + 1);
+                            return true;
+                        }
+                    }
+                }
+                exists = false;
+                return false;
+            }
+
+        private:
+            /** Устанавливает первые допустимые альтернативы разрядов начиная с from. */
+            void reset(size_t from) {
+                for (size_t slot = from; slot < choices.size(); slot++) {
+                    size_t parent = layout->parent(slot);
+                    active[slot] = parent == layout_t::npos ||
+                        (active[parent] && choices[parent] == layout->branch(slot));
+                    choices[slot] = 0;
+                    size_t count = layout->node(slot)->childCount();
+                    for (size_t i = 0; i < count; i++) {
+                        if (subspace.isAllowed(slot, i)) { choices[slot] = i; break; }
+                    }
+                }
+            }
+
+            bool hasAllowed(size_t slot) const {
+                return subspace.isAllowed(slot, choices[slot]);
+            }
+
+            subspace_t subspace;
+            std::shared_ptr<const layout_t> layout;
+            std::vector<size_t> choices;
+            std::vector<bool> active;
+            bool exists;
+        };
+
+        /**
+         * Отбор решений при сужении множества решений: если каждый
+         * изменённый разряд до изменения не был зафиксирован, новое
+         * множество решений - подмножество прежнего, и его можно получить
+         * отбором уже найденных решений по индексам выбранных альтернатив
+         * (см. SolutionView::choiceIndices()) без перебора. Проверяются
+         * только изменённые разряды, входящие в решение.
+         */
+        template <typename Key, typename Value>
+        class NarrowingFilter {
+        public:
+            typedef ChoiceLayout<Key, Value> layout_t;
+
+            NarrowingFilter(std::shared_ptr<const layout_t> layout,
+                            const std::vector<size_t> &before,
+                            const std::vector<size_t> &after):
+                layout(std::move(layout)),
+                narrowing(true)
+            {
+                assert(before.size() == this->layout->size() && after.size() == this->layout->size());
+                for (size_t slot = 0; slot < before.size(); slot++) {
+                    if (before[slot] == after[slot]) { continue; }
+                    if (before[slot] != this->layout->node(slot)->childCount()) { narrowing = false; }
+                    changed.push_back(std::make_pair(slot, after[slot]));
+                }
+            }
+
+            /** Значение "является ли новое множество решений подмножеством прежнего?" */
+            bool isNarrowing() const { return narrowing; }
+
+            /** Значение "изменялись ли зафиксированные узлы?" */
+            bool isEmpty() const { return changed.empty(); }
+
+            /** Значение "остаётся ли решение с индексами choices в новом множестве?" */
+            bool accepts(const std::vector<size_t> &choices) const {
+                assert(narrowing && choices.size() == layout->size());
+                for (auto &change : changed) {
+                    if (choices[change.first] != change.second && layout->isActive(choices, change.first)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+        private:
+            std::shared_ptr<const layout_t> layout;
+            /** Изменённые разряды и их новые зафиксированные индексы. */
+            std::vector<std::pair<size_t, size_t>> changed;
+            bool narrowing;
+        };
+
+        /**
+         * Разность множеств решений до и после изменения зафиксированных
+         * узлов: непересекающиеся подпространства удалённых и добавленных
+         * решений.
+         */
+        template <typename Key, typename Value>
+        struct SolutionDiff {
+            typedef Subspace<Key, Value> subspace_t;
+
+            bool empty() const { return removed.empty() && added.empty(); }
+
+            std::vector<subspace_t> removed;
+            std::vector<subspace_t> added;
+        };
+
+        namespace internal {
+            /** Множество альтернатив, допустимых при фиксации fixed. */
+            inline std::vector<bool> allowedSet(size_t fixed, size_t count) {
+                std::vector<bool> allowed(count, fixed == count);
+                if (fixed < count) { allowed[fixed] = true; }
+                return allowed;
+            }
+
+            /**
+             * Собирает подпространства решений, допустимых при from,
+             * но недопустимых при to.
+             */
+            template <typename Key, typename Value>
+            void collectSubspaces(const std::shared_ptr<const ChoiceLayout<Key, Value>> &layout,
+                                  const std::shared_ptr<const std::vector<size_t>> &from,
+                                  const std::vector<size_t> &to,
+                                  const std::vector<size_t> &changed,
+                                  std::vector<Subspace<Key, Value>> &subspaces)
+            {
+                typedef ChoiceLayout<Key, Value> layout_t;
+                typedef typename Subspace<Key, Value>::constraints_t constraints_t;
+
+                auto allowed = [&] (constraints_t &constraints, size_t slot) -> std::vector<bool> & {
+                    auto found = constraints.find(slot);
+                    if (found == constraints.end()) {
+                        size_t count = layout->node(slot)->childCount();
+                        found = constraints.insert(std::make_pair(slot, allowedSet((*from)[slot], count))).first;
+                    }
+                    return found->second;
+                };
+
+                for (size_t j = 0; j < changed.size(); j++) {
+                    size_t slot = changed[j];
+                    size_t count = layout->node(slot)->childCount();
+                    std::vector<bool> forbidden = allowedSet((*from)[slot], count);
+                    std::vector<bool> kept = allowedSet(to[slot], count);
+                    bool any = false;
+                    for (size_t i = 0; i < count; i++) {
+                        forbidden[i] = forbidden[i] && !kept[i];
+                        any = any || forbidden[i];
+                    }
+                    if (!any) { continue; }
+
+                    constraints_t constraints;
+                    for (size_t k = 0; k < j; k++) {
+                        std::vector<bool> &set = allowed(constraints, changed[k]);
+                        std::vector<bool> both = allowedSet(to[changed[k]], set.size());
+                        for (size_t i = 0; i < set.size(); i++) { set[i] = set[i] && both[i]; }
+                    }
+                    constraints[slot] = forbidden;
+                    // разряд slot должен быть активен
+                    for (size_t s = slot; layout->parent(s) != layout_t::npos; s = layout->parent(s)) {
+                        std::vector<bool> &set = allowed(constraints, layout->parent(s));
+                        for (size_t i = 0; i < set.size(); i++) {
+                            set[i] = set[i] && i == layout->branch(s);
+                        }
+                    }
+                    // разряд без допустимых альтернатив исключается вместе с ветвью,
+                    // ведущей к нему; охватывающие разряды имеют меньшие номера
+                    bool possible = true;
+                    for (auto it = constraints.end(); possible && it != constraints.begin();) {
+                        --it;
+                        bool none = true;
+                        for (size_t i = 0; i < it->second.size(); i++) {
+                            if (it->second[i]) { none = false; break; }
+                        }
+                        if (!none) { continue; }
+                        size_t parent = layout->parent(it->first);
+                        if (parent == layout_t::npos) {
+                            possible = false;
+                        } else {
+                            allowed(constraints, parent)[layout->branch(it->first)] = false;
+                        }
+                    }
+                    if (possible) {
+                        subspaces.push_back(Subspace<Key, Value>(layout, from, std::move(constraints)));
+                    }
+                }
+            }
+        }
+
+        /**
+         * Возвращает разность множеств решений при зафиксированных узлах
+         * before и after (см. fixedState) без построения самих множеств.
+         * Решение удалено, если оно допустимо при before и в каком-то
+         * изменённом разряде выбрана альтернатива, недопустимая при after;
+         * удалённые решения разбиваются по первому такому разряду d:
+         * в изменённых разрядах до d допустимы альтернативы, разрешённые
+         * и до, и после изменения, разряд d активен (охватывающие разряды
+         * выбирают ведущие к нему ветви) и в нём выбрана запрещённая
+         * после изменения альтернатива. Добавленные решения симметричны.
+         * Фиксация значения даёт только подпространство удалённых
+         * альтернатив, снятие фиксации - только вновь разрешённых.
+         * Подпространства строятся за время, пропорциональное числу
+         * изменённых разрядов и глубине их вложенности, а перебор
+         * подпространств - пропорционально числу изменившихся решений.
+         */
+        template <typename Key, typename Value>
+        SolutionDiff<Key, Value> diffSolutions(std::shared_ptr<const ChoiceLayout<Key, Value>> layout,
+                                               const std::vector<size_t> &before,
+                                               const std::vector<size_t> &after)
+        {
+            assert(before.size() == layout->size() && after.size() == layout->size());
+            std::vector<size_t> changed;
+            for (size_t slot = 0; slot < before.size(); slot++) {
+                if (before[slot] != after[slot]) { changed.push_back(slot); }
+            }
+            SolutionDiff<Key, Value> diff;
+            if (changed.empty()) { return diff; }
+
+            auto beforeState = std::make_shared<const std::vector<size_t>>(before);
+            auto afterState = std::make_shared<const std::vector<size_t>>(after);
+            internal::collectSubspaces(layout, beforeState, after, changed, diff.removed);
+            internal::collectSubspaces(layout, afterState, before, changed, diff.added);
+            return diff;
+        }
+    }
+}
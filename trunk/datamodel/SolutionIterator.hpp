@@ -4,8 +4,13 @@
 #include <vector>
 #include <algorithm>
 #include <numeric>
+#include <memory>
 
 #include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+#include "SolutionView.hpp"
+#include "Checkpoint.hpp"
+#include "FixedShapeCounter.hpp"
 
 namespace vehicle {
     namespace algorithm {
@@ -19,13 +24,18 @@ namespace vehicle {
                 hasChoice(true),
                 isFixed(isFixed),
                 index(index),
-                power(0) {}
+                power(0),
+                shape(noShape) {}
             Choice(const node_t *node):
                 node(node),
                 hasChoice(false),
                 isFixed(false),
                 index(0),
-                power(0) {}
+                power(0),
+                shape(noShape) {}
+
+            static const size_t noShape = (size_t)-1;
+
             /** Узел исходного дерева. */
             const node_t * const node;
             /**
@@ -52,6 +62,11 @@ namespace vehicle {
              * с учётом зафиксированных узлов.
              */
             size_t power;
+            /**
+             * Номер поддерева фиксированной формы (см. FixedShapeCounter.hpp),
+             * корнем которого является узел, либо noShape.
+             */
+            size_t shape;
         };
 
         template <typename Key, typename Value>
@@ -84,34 +99,141 @@ namespace vehicle {
             typedef Choice<Key, Value> choice_t;
             typedef AndOrTree<Key, choice_t> solution_tree_t;
             typedef typename solution_tree_t::node_t solution_node_t;
+            typedef ChoiceLayout<Key, Value> layout_t;
+            typedef SolutionView<Key, Value> view_t;
 
             SolutionIterator(const tree_t &source):
                 source(source),
-                solution(&choiceBasedComputeKey<Key, Value>)
+                solution(&choiceBasedComputeKey<Key, Value>),
+                layout(std::make_shared<layout_t>(source.getRoot())),
+                unrolled(true)
             {
                 solution.setRoot(deepCloneNodeForSolution(source.getRoot()));
+                collectChoiceNodes(solution.getRoot(), choiceNodes);
+                prepareShapes();
             }
 
-            size_t solutionCount() {
+            SolutionIterator(const SolutionIterator &other):
+                source(other.source),
+                solution(other.solution),
+                layout(other.layout),
+                unrolled(other.unrolled)
+            {
+                collectChoiceNodes(solution.getRoot(), choiceNodes);
+                prepareShapes();
+            }
+
+            size_t solutionCount() const {
                 return solution.getRoot()->getValue().power;
             }
 
+            /** Значение "есть ли хотя бы одно решение?" */
+            bool hasSolution() const {
+                return solutionCount() != 0;
+            }
+
+            /** Разметка разрядов выбора исходного дерева. */
+            const layout_t & choiceLayout() const {
+                return *layout;
+            }
+
             bool nextSolution() {
                 Switch sw = nextChoice(solution.getRoot());
                 return sw == Success;
             }
 
+            /**
+             * Включает или отключает перебор поддеревьев фиксированной формы
+             * развёрнутыми счётчиками (см. FixedShapeCounter.hpp); порядок
+             * перебора при этом не меняется. По умолчанию включён.
+             */
+            void setUnrolledEnumeration(bool enabled) {
+                unrolled = enabled;
+            }
+
+            bool isUnrolledEnumeration() const {
+                return unrolled;
+            }
+
+            /**
+             * Переходит к решению с порядковым номером index (начиная с 0)
+             * в порядке перебора nextSolution(), т.е. после seek(index)
+             * итератор находится в том же состоянии, что и после index
+             * вызовов nextSolution() от начала перебора.
+             * @param index номер решения; должен быть меньше solutionCount()
+             */
+            void seek(size_t index) {
+                assert(index < solutionCount());
+                seekChoice(solution.getRoot(), index);
+            }
+
             const solution_tree_t & currentSolution() const {
                 return solution;
             }
 
-        private:
-            enum Switch { None, Success, Overflow };
+            /**
+             * Возвращает состояние перебора, из которого его можно
+             * продолжить (restore()) после перезапуска процесса.
+             * Хеш модели рассчитывается обходом дерева.
+             */
+            Checkpoint checkpoint() const {
+                Checkpoint result;
+                result.modelHash = modelHash(source);
+                result.fixedFingerprint = fixedFingerprint(*layout);
+                result.choices.resize(choiceNodes.size());
+                for (size_t slot = 0; slot < choiceNodes.size(); slot++) {
+                    result.choices[slot] = choiceNodes[slot]->getValue().index;
+                }
+                return result;
+            }
+
+            /**
+             * Восстанавливает состояние перебора, сохранённое checkpoint():
+             * после восстановления nextSolution() продолжает перебор с того же
+             * решения, на котором он был сохранён.
+             * @return false, если модель или зафиксированные узлы изменились
+             *     либо состояние не соответствует дереву; итератор при этом
+             *     не изменяется
+             */
+            bool restore(const Checkpoint &checkpoint) {
+                if (checkpoint.modelHash != modelHash(source) ||
+                    checkpoint.fixedFingerprint != fixedFingerprint(*layout) ||
+                    checkpoint.choices.size() != choiceNodes.size())
+                {
+                    return false;
+                }
+                for (size_t slot = 0; slot < choiceNodes.size(); slot++) {
+                    const auto &choice = choiceNodes[slot]->getValue();
+                    size_t index = checkpoint.choices[slot];
+                    if (index >= choiceNodes[slot]->childCount() || (choice.isFixed && index != choice.index)) {
+                        return false;
+                    }
+                }
+                for (size_t slot = choiceNodes.size(); slot-- > 0;) {
+                    choiceNodes[slot]->getValue().index = checkpoint.choices[slot];
+                    solution.recomputeKey(choiceNodes[slot]);
+                }
+                return true;
+            }
 
-            bool hasChoice(const node_t *node) {
-                return node->getKind() == NodeKind::OR && !node->isLeaf();
+            /**
+             * Возвращает компактное представление текущего решения
+             * (без копирования дерева решения).
+             */
+            view_t currentView() const {
+                std::vector<size_t> choices(choiceNodes.size());
+                for (size_t slot = 0; slot < choices.size(); slot++) {
+                    choices[slot] = choiceNodes[slot]->getValue().index;
+                }
+                auto root = solution.getRoot();
+                return view_t(layout, std::move(choices), root ? root->subtreeKey() : Key());
             }
 
+        protected:
+            enum Switch { None, Success, Overflow };
+
+            typedef FixedShape<solution_node_t *> shape_t;
+
             solution_node_t * deepCloneNodeForSolution(const node_t *node) {
                 bool choiceExists = hasChoice(node);
                 auto solutionNode = solution.create(
@@ -126,21 +248,20 @@ namespace vehicle {
 
             choice_t createChoice(const node_t *parent) {
                 assert(parent && hasChoice(parent));
-                auto begin = parent->begin();
-                auto end = parent->end();
-                auto it = std::find_if(begin, end, [] (const node_t *child) {
-                    return child->getValue().isFixed();
-                });
-                if (it == end) {
+                size_t fixedIndex = fixedChildIndex(parent);
+                if (fixedIndex == parent->childCount()) {
                     return choice_t(parent, false, 0);
                 } else {
-                    return choice_t(parent, true, it - begin);
+                    return choice_t(parent, true, fixedIndex);
                 }
             }
 
             Switch nextChoice(solution_node_t *node) {
                 if (node->isLeaf()) { return None; }
                 auto &choice = node->getValue();
+                if (choice.shape != choice_t::noShape && unrolled) {
+                    return nextShape(shapes[choice.shape]);
+                }
                 Switch sw = None;
                 if (choice.hasChoice) {
                     auto choiceIndex = choice.index;
@@ -168,6 +289,118 @@ namespace vehicle {
                 return sw;
             }
 
+            /**
+             * Переводит поддерево фиксированной формы к следующему решению;
+             * ключи изменённых узлов и их предков пересчитываются один раз.
+             */
+            Switch nextShape(shape_t &shape) {
+                size_t changed = nextFixedShape(shape);
+                bool overflow = changed > shape.size;
+                if (overflow) { changed = shape.size; }
+                for (size_t digit = 0; digit < changed; digit++) {
+                    solution.recomputeKey(shape.nodes[digit], shape.root);
+                }
+                solution.recomputeKey(shape.root);
+                return overflow ? Overflow : Success;
+            }
+
+            void prepareShapes() {
+                shapes.clear();
+                auto root = solution.getRoot();
+                if (!root) { return; }
+                size_t count = markShapes(root);
+                if (count != choice_t::noShape) { addShape(root, count); }
+            }
+
+            /**
+             * Находит наибольшие поддеревья фиксированной формы
+             * не более чем из maxFixedShapeSize разрядов.
+             * @return количество узлов выбора поддерева node, если оно
+             *     подходит для развёрнутого перебора, иначе noShape
+             */
+            size_t markShapes(solution_node_t *node) {
+                auto &choice = node->getValue();
+                choice.shape = choice_t::noShape;
+                std::vector<size_t> counts;
+                counts.reserve(node->childCount());
+                bool fits = true;
+                size_t count = choice.hasChoice ? 1 : 0;
+                for (auto child : *node) {
+                    counts.push_back(markShapes(child));
+                    if (counts.back() == choice_t::noShape ||
+                        (choice.hasChoice && counts.back() != 0))
+                    {
+                        fits = false;
+                    } else {
+                        count += counts.back();
+                    }
+                }
+                if (fits && count <= maxFixedShapeSize) { return count; }
+                for (size_t i = 0; i < counts.size(); i++) {
+                    if (counts[i] != choice_t::noShape) { addShape(node->child(i), counts[i]); }
+                }
+                return choice_t::noShape;
+            }
+
+            /**
+             * Добавляет поддерево фиксированной формы из count разрядов.
+             * Одиночный ИЛИ-узел из листьев не добавляется: общий перебор
+             * обрабатывает его так же быстро.
+             */
+            void addShape(solution_node_t *root, size_t count) {
+                if (count == 0 || (count == 1 && root->getValue().hasChoice)) { return; }
+                shapes.push_back(shape_t());
+                shapes.back().root = root;
+                collectShape(root, shapes.back());
+                root->getValue().shape = shapes.size() - 1;
+            }
+
+            /** Собирает разряды поддерева фиксированной формы от младшего к старшему. */
+            void collectShape(solution_node_t *node, shape_t &shape) {
+                auto &choice = node->getValue();
+                if (choice.hasChoice) {
+                    size_t digit = shape.size++;
+                    shape.nodes[digit] = node;
+                    shape.digits[digit] = &choice.index;
+                    shape.firsts[digit] = choice.isFixed ? choice.index : 0;
+                    shape.limits[digit] = choice.isFixed ? choice.index + 1 : node->childCount();
+                    return;
+                }
+                for (auto child : *node) {
+                    collectShape(child, shape);
+                }
+            }
+
+            /**
+             * Устанавливает в поддереве node решение с номером index;
+             * поддеревья невыбранных альтернатив возвращаются в начальное
+             * состояние, как после их переполнения в nextChoice.
+             * Первый ребёнок И-узла - младший разряд.
+             */
+            void seekChoice(solution_node_t *node, size_t index) {
+                if (node->isLeaf()) { return; }
+                auto &choice = node->getValue();
+                if (choice.hasChoice) {
+                    size_t choosen = choice.index;
+                    if (!choice.isFixed) {
+                        for (choosen = 0; index >= node->child(choosen)->getValue().power; choosen++) {
+                            index -= node->child(choosen)->getValue().power;
+                        }
+                    }
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        seekChoice(node->child(i), i == choosen ? index : 0);
+                    }
+                    choice.index = choosen;
+                    solution.recomputeKey(node);
+                } else {
+                    for (auto child : *node) {
+                        size_t power = child->getValue().power;
+                        seekChoice(child, index % power);
+                        index /= power;
+                    }
+                }
+            }
+
             void recomputePower(solution_node_t *node) {
                 auto &choice = node->getValue();
                 if (choice.hasChoice) {
@@ -180,12 +413,19 @@ namespace vehicle {
                     }
                 } else {
                     choice.power = std::accumulate(node->begin(), node->end(), (size_t)1,
-                        [] (size_t acc, solution_node_t *n) { return std::max(acc, n->getValue().power); });
+                        [] (size_t acc, solution_node_t *n) { return acc * n->getValue().power; });
                 }
             }
 
             const tree_t &source;
             solution_tree_t solution;
+            /** Разметка разрядов выбора, общая для всех копий итератора. */
+            std::shared_ptr<const layout_t> layout;
+            /** Узлы выбора дерева решения в порядке разрядов layout. */
+            std::vector<solution_node_t *> choiceNodes;
+            /** Поддеревья фиксированной формы (Choice::shape). */
+            std::vector<shape_t> shapes;
+            bool unrolled;
         };
 
         template <typename Stream, typename Key, typename Value>
@@ -0,0 +1,180 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "AndOrTree.hpp"
+#include "ChoiceLayout.hpp"
+#include "SolutionView.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /**
+         * Случайная выборка решений И-ИЛИ дерева с учётом зафиксированных узлов.
+         * Вероятность решения пропорциональна произведению весов выбранных
+         * альтернатив (детей ИЛИ-узлов); при единичных весах выборка
+         * равномерна по множеству решений.
+         * Для каждого поддерева заранее рассчитывается суммарный вес его
+         * решений, поэтому в каждом узле выбора альтернатива выбирается
+         * за один проход, а решение строится за один обход его узлов.
+         * Генератор (mt19937_64) и преобразование его значений
+         * в выбор альтернативы зависят только от seed, т.е. выборка
+         * воспроизводима на любой платформе.
+         * Исходное дерево не должно изменяться, пока используется выборка.
+         */
+        template <typename Key, typename Value>
+        class SolutionSampler {
+        public:
+            typedef AndOrTree<Key, Value> tree_t;
+            typedef Node<Key, Value> node_t;
+            typedef ChoiceLayout<Key, Value> layout_t;
+            typedef SolutionView<Key, Value> view_t;
+
+            /** Равномерная выборка. */
+            explicit SolutionSampler(const tree_t &source, unsigned long long seed = 0):
+                layout(std::make_shared<layout_t>(source.getRoot())),
+                random(seed)
+            {
+                prepare([] (const node_t *) { return 1.0; });
+            }
+
+            /**
+             * Взвешенная выборка.
+             * @param weightOf функция веса альтернативы: double weightOf(const node_t *),
+             *     вес должен быть неотрицательным
+             */
+            template <typename Weight>
+            SolutionSampler(const tree_t &source, unsigned long long seed, Weight weightOf):
+                layout(std::make_shared<layout_t>(source.getRoot())),
+                random(seed)
+            {
+                prepare(weightOf);
+            }
+
+            /** Перезапускает генератор с начальным значением seed. */
+            void reseed(unsigned long long seed) {
+                random.seed(seed);
+            }
+
+            /**
+             * Значение "есть ли хотя бы одно решение с ненулевым весом?"
+             * Выбирать решения можно только при истинном значении.
+             */
+            bool hasSolution() const {
+                return layout->root() && totalWeight > 0;
+            }
+
+            /**
+             * Возвращает суммарный вес всех решений; при равномерной
+             * выборке - количество решений.
+             */
+            double weight() const {
+                return totalWeight;
+            }
+
+            /** Выбирает случайное решение. */
+            view_t sample() {
+                assert(hasSolution());
+                std::vector<size_t> choices(defaults);
+                Key price = Key();
+                sample(layout->root(), choices, price);
+                return view_t(layout, std::move(choices), price);
+            }
+
+            /** Выбирает count случайных решений (возможны повторы). */
+            std::vector<view_t> sample(size_t count) {
+                std::vector<view_t> samples;
+                samples.reserve(count);
+                for (size_t i = 0; i < count; i++) {
+                    samples.push_back(sample());
+                }
+                return samples;
+            }
+
+        private:
+            template <typename Weight>
+            void prepare(Weight weightOf) {
+                size_t count = layout->size();
+                defaults.resize(count);
+                offsets.resize(count + 1, 0);
+                for (size_t slot = 0; slot < count; slot++) {
+                    const node_t *node = layout->node(slot);
+                    size_t fixedIndex = fixedChildIndex(node);
+                    defaults[slot] = fixedIndex == node->childCount() ? 0 : fixedIndex;
+                    offsets[slot + 1] = offsets[slot] + node->childCount();
+                }
+                cumulative.resize(offsets.back());
+                totalWeight = layout->root() ? prepare(layout->root(), weightOf) : 0;
+            }
+
+            /**
+             * Рассчитывает суммарный вес решений поддерева node и накопленные
+             * веса альтернатив узлов выбора.
+             */
+            template <typename Weight>
+            double prepare(const node_t *node, Weight &weightOf) {
+                if (hasChoice(node)) {
+                    size_t slot = layout->slotOf(node);
+                    size_t fixedIndex = fixedChildIndex(node);
+                    double sum = 0;
+                    for (size_t i = 0; i < node->childCount(); i++) {
+                        const node_t *child = node->child(i);
+                        double childWeight = prepare(child, weightOf);
+                        if (fixedIndex == node->childCount() || i == fixedIndex) {
+                            double w = weightOf(child);
+                            assert(w >= 0);
+                            sum += w * childWeight;
+                        }
+                        cumulative[offsets[slot] + i] = sum;
+                    }
+                    return sum;
+                }
+                double product = 1;
+                for (auto child : *node) {
+                    product *= prepare(child, weightOf);
+                }
+                return product;
+            }
+
+            void sample(const node_t *node, std::vector<size_t> &choices, Key &price) {
+                price = price + node->ownKey();
+                if (hasChoice(node)) {
+                    size_t slot = layout->slotOf(node);
+                    auto begin = cumulative.begin() + offsets[slot];
+                    auto end = cumulative.begin() + offsets[slot + 1];
+                    double point = uniform() * *(end - 1);
+                    // первая альтернатива, накопленный вес которой больше point
+                    size_t index = std::upper_bound(begin, end, point) - begin;
+                    index = std::min(index, node->childCount() - 1);
+                    choices[slot] = index;
+                    sample(node->child(index), choices, price);
+                } else {
+                    for (auto child : *node) {
+                        sample(child, choices, price);
+                    }
+                }
+            }
+
+            /** Возвращает случайное число из [0, 1) с 53 значащими битами. */
+            double uniform() {
+                return (random() >> 11) * (1.0 / 9007199254740992.0);
+            }
+
+            std::shared_ptr<const layout_t> layout;
+            std::mt19937_64 random;
+            double totalWeight;
+
+            /** Индексы неактивных разрядов (первая или зафиксированная альтернатива). */
+            std::vector<size_t> defaults;
+            /** Начало альтернатив разряда в cumulative. */
+            std::vector<size_t> offsets;
+            /** Накопленные веса альтернатив всех разрядов. */
+            std::vector<double> cumulative;
+        };
+    }
+}
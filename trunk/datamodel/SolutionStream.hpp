@@ -0,0 +1,165 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <utility>
+#define VEHICLE_HAS_COROUTINES 1
+#endif
+
+namespace vehicle {
+    namespace algorithm {
+        /**
+         * Потоковый перебор решений: решения передаются приёмнику (sink)
+         * по одному или пакетами и нигде не накапливаются, т.е. перебор
+         * любого количества решений выполняется в постоянной памяти.
+         * Iterator - любой итератор решений с методами hasSolution(),
+         * nextSolution() и currentView() (SolutionIterator,
+         * BranchAndBoundIterator, GrayCodeIterator).
+         * Приёмник возвращает true, чтобы продолжить перебор,
+         * и false, чтобы остановить его.
+         */
+
+        /**
+         * Передаёт приёмнику sink(const Iterator &) каждое решение,
+         * начиная с текущего.
+         * @return количество переданных решений
+         */
+        template <typename Iterator, typename Sink>
+        size_t forEachSolution(Iterator &solutions, Sink sink) {
+            size_t count = 0;
+            if (!solutions.hasSolution()) { return count; }
+            do {
+                count++;
+                if (!sink(static_cast<const Iterator &>(solutions))) { break; }
+            } while (solutions.nextSolution());
+            return count;
+        }
+
+        /**
+         * Передаёт приёмнику sink(const std::vector<view_t> &) решения
+         * пакетами по batchSize представлений (последний пакет может быть
+         * меньше), начиная с текущего решения. Память пакета используется
+         * повторно.
+         * @return количество переданных решений
+         */
+        template <typename Iterator, typename Sink>
+        size_t forEachBatch(Iterator &solutions, size_t batchSize, Sink sink) {
+            assert(batchSize > 0);
+            typedef decltype(solutions.currentView()) view_t;
+            std::vector<view_t> batch;
+            batch.reserve(batchSize);
+            size_t count = 0;
+            if (!solutions.hasSolution()) { return count; }
+            bool more;
+            do {
+                batch.push_back(solutions.currentView());
+                more = solutions.nextSolution();
+                if (batch.size() == batchSize || !more) {
+                    count += batch.size();
+                    if (!sink(static_cast<const std::vector<view_t> &>(batch))) { break; }
+                    batch.clear();
+                }
+            } while (more);
+            return count;
+        }
+
+#ifdef VEHICLE_HAS_COROUTINES
+        /**
+         * Генератор C++20: ленивая последовательность значений T,
+         * вычисляемых сопрограммой при обходе range-for.
+         * Досрочный выход из цикла уничтожает сопрограмму,
+         * т.е. останавливает перебор.
+         */
+        template <typename T>
+        class Generator {
+        public:
+            struct promise_type {
+                T *current;
+
+                Generator get_return_object() {
+                    return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+                }
+                std::suspend_always initial_suspend() noexcept { return std::suspend_always(); }
+                std::suspend_always final_suspend() noexcept { return std::suspend_always(); }
+                std::suspend_always yield_value(T &value) noexcept {
+                    current = &value;
+                    return std::suspend_always();
+                }
+                void return_void() noexcept {}
+                void unhandled_exception() { throw; }
+            };
+
+            class iterator {
+            public:
+                explicit iterator(std::coroutine_handle<promise_type> handle): handle(handle) {}
+                iterator & operator++() {
+                    handle.resume();
+                    return *this;
+                }
+                const T & operator*() const { return *handle.promise().current; }
+                bool operator==(std::default_sentinel_t) const { return !handle || handle.done(); }
+            private:
+                std::coroutine_handle<promise_type> handle;
+            };
+
+            Generator(Generator &&other) noexcept: handle(std::exchange(other.handle, nullptr)) {}
+            Generator(const Generator &) = delete;
+            Generator & operator=(const Generator &) = delete;
+            ~Generator() {
+                if (handle) { handle.destroy(); }
+            }
+
+            iterator begin() {
+                if (handle) { handle.resume(); }
+                return iterator(handle);
+            }
+            std::default_sentinel_t end() const { return std::default_sentinel; }
+
+        private:
+            explicit Generator(std::coroutine_handle<promise_type> handle): handle(handle) {}
+
+            std::coroutine_handle<promise_type> handle;
+        };
+
+        /**
+         * Возвращает генератор представлений решений, начиная с текущего.
+         * Итератор решений перемещается в сопрограмму.
+         */
+        template <typename Iterator>
+        auto solutionViews(Iterator solutions) -> Generator<decltype(solutions.currentView())> {
+            if (!solutions.hasSolution()) { co_return; }
+            do {
+                auto view = solutions.currentView();
+                co_yield view;
+            } while (solutions.nextSolution());
+        }
+
+        /**
+         * Возвращает генератор пакетов представлений решений
+         * по batchSize решений (последний пакет может быть меньше).
+         */
+        template <typename Iterator>
+        auto solutionBatches(Iterator solutions, size_t batchSize)
+            -> Generator<std::vector<decltype(solutions.currentView())>>
+        {
+            std::vector<decltype(solutions.currentView())> batch;
+            batch.reserve(batchSize);
+            if (!solutions.hasSolution()) { co_return; }
+            bool more;
+            do {
+                batch.push_back(solutions.currentView());
+                more = solutions.nextSolution();
+                if (batch.size() == batchSize || !more) {
+                    co_yield batch;
+                    batch.clear();
+                }
+            } while (more);
+        }
+#endif
+    }
+}
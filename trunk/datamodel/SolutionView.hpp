@@ -0,0 +1,102 @@
+﻿#pragma once
+
+#include <assert.h>
+#include <memory>
+#include <vector>
+
+#include "ChoiceLayout.hpp"
+
+namespace vehicle {
+    namespace algorithm {
+        using namespace core;
+
+        /**
+         * Компактное представление решения: индексы выбранных альтернатив
+         * по одному на разряд выбора (см. ChoiceLayout) и общая стоимость.
+         * В отличие от дерева решения (SolutionIterator::currentSolution())
+         * не копирует структуру исходного дерева, а ссылается на неё
+         * через разметку, поэтому исходное дерево не должно изменяться,
+         * пока используется представление.
+         * Индексы неактивных разрядов (не участвующих в решении)
+         * не имеют значения.
+         */
+        template <typename Key, typename Value>
+        class SolutionView {
+        public:
+            typedef Node<Key, Value> node_t;
+            typedef ChoiceLayout<Key, Value> layout_t;
+
+            SolutionView(): price() {}
+
+            SolutionView(std::shared_ptr<const layout_t> layout, std::vector<size_t> choices, const Key &price):
+                layout(std::move(layout)),
+                choices(std::move(choices)),
+                price(price)
+            {
+                assert(this->layout && this->layout->size() == this->choices.size());
+            }
+
+            /** Возвращает общую стоимость решения. */
+            const Key & totalPrice() const { return price; }
+
+            /** Возвращает корень исходного дерева. */
+            const node_t * root() const {
+                return layout ? layout->root() : nullptr;
+            }
+
+            /** Возвращает разметку разрядов выбора исходного дерева. */
+            const layout_t & choiceLayout() const { return *layout; }
+
+            /** Возвращает индексы выбранных альтернатив по разрядам. */
+            const std::vector<size_t> & choiceIndices() const { return choices; }
+
+            /** Возвращает индекс выбранной альтернативы разряда slot. */
+            size_t choice(size_t slot) const { return choices.at(slot); }
+
+            /**
+             * Возвращает индекс выбранного ребёнка узла выбора node
+             * (см. hasChoice) исходного дерева.
+             */
+            size_t choiceOf(const node_t *node) const {
+                size_t slot = layout->slotOf(node);
+                assert(slot != layout_t::npos);
+                return choices[slot];
+            }
+
+            /** Возвращает выбранного ребёнка узла выбора node исходного дерева. */
+            const node_t * chosenChild(const node_t *node) const {
+                return node->child(choiceOf(node));
+            }
+
+            /** Значение "участвует ли разряд slot в решении?" */
+            bool isActive(size_t slot) const {
+                return layout->isActive(choices, slot);
+            }
+
+            /**
+             * Обходит узлы решения в исходном дереве (Родитель-Дети):
+             * у узлов выбора посещается только выбранный ребёнок.
+             * Для каждого узла вызывается visit(node).
+             */
+            template <typename Visitor>
+            void walk(Visitor visit) const {
+                if (const node_t *node = root()) { walk(node, visit); }
+            }
+
+        private:
+            template <typename Visitor>
+            void walk(const node_t *node, Visitor &visit) const {
+                visit(node);
+                if (hasChoice(node)) {
+                    walk(chosenChild(node), visit);
+                } else {
+                    for (auto child : *node) { walk(child, visit); }
+                }
+            }
+
+            std::shared_ptr<const layout_t> layout;
+            std::vector<size_t> choices;
+            Key price;
+        };
+    }
+}
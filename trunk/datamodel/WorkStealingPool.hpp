@@ -0,0 +1,112 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vehicle {
+    namespace algorithm {
+        /**
+         * Пул потоков с перехватом задач (work stealing).
+         * Задачи - номера из диапазона [0, taskCount); каждый поток
+         * получает непрерывный блок номеров и выполняет их с начала блока,
+         * а опустевший поток забирает задачи с конца блоков других потоков.
+         * Потоки создаются на время вызова run().
+         */
+        class WorkStealingPool {
+        public:
+            /**
+             * @param threadCount количество потоков; 0 - по количеству
+             *     аппаратных потоков процессора
+             */
+            explicit WorkStealingPool(size_t threadCount = 0):
+                threadCount(threadCount ? threadCount : defaultThreadCount()) {}
+
+            /** Возвращает количество потоков пула. */
+            size_t size() const { return threadCount; }
+
+            /**
+             * Выполняет task(index) для каждого index из [0, taskCount)
+             * и возвращает управление после выполнения всех задач.
+             * task вызывается одновременно из нескольких потоков.
+             */
+            template <typename Task>
+            void run(size_t taskCount, Task task) {
+                size_t workers = std::min(threadCount, taskCount);
+                if (workers <= 1) {
+                    for (size_t index = 0; index < taskCount; index++) { task(index); }
+                    return;
+                }
+
+                Queues queues(workers);
+                for (size_t w = 0; w < workers; w++) {
+                    for (size_t index = taskCount * w / workers; index < taskCount * (w + 1) / workers; index++) {
+                        queues[w].tasks.push_back(index);
+                    }
+                }
+
+                std::vector<std::thread> threads;
+                for (size_t w = 1; w < workers; w++) {
+                    threads.push_back(std::thread([&queues, &task, w] () { work(queues, w, task); }));
+                }
+                work(queues, 0, task);
+                for (auto &thread : threads) { thread.join(); }
+            }
+
+        private:
+            struct Queue {
+                std::mutex mutex;
+                std::deque<size_t> tasks;
+            };
+
+            /** Очереди задач потоков (Queue не копируется, поэтому не std::vector). */
+            class Queues {
+            public:
+                explicit Queues(size_t count): queues(new Queue[count]), count(count) {}
+                Queue & operator[](size_t index) { return queues[index]; }
+                size_t size() const { return count; }
+            private:
+                std::unique_ptr<Queue[]> queues;
+                size_t count;
+            };
+
+            static size_t defaultThreadCount() {
+                size_t count = std::thread::hardware_concurrency();
+                return count ? count : 1;
+            }
+
+            template <typename Task>
+            static void work(Queues &queues, size_t self, Task &task) {
+                size_t index;
+                while (take(queues[self], true, index) || steal(queues, self, index)) {
+                    task(index);
+                }
+            }
+
+            static bool steal(Queues &queues, size_t self, size_t &index) {
+                for (size_t i = 1; i < queues.size(); i++) {
+                    if (take(queues[(self + i) % queues.size()], false, index)) { return true; }
+                }
+                return false;
+            }
+
+            static bool take(Queue &queue, bool front, size_t &index) {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.tasks.empty()) { return false; }
+                if (front) {
+                    index = queue.tasks.front();
+                    queue.tasks.pop_front();
+                } else {
+                    index = queue.tasks.back();
+                    queue.tasks.pop_back();
+                }
+                return true;
+            }
+
+            size_t threadCount;
+        };
+    }
+}
@@ -35,50 +35,50 @@ ModelQmlBridge::ModelQmlBridge(QObject* parent) : QObject(parent), parameterMode
 bool ModelQmlBridge::initialize(QQmlEngine* engine, QString* error)
 {
     /*tree_ = new AOTree;
-    tree_->setRoot(tree_->create(NodeKind::OR, decimal2(0), NodeItem("Mark"))
-         ->attach(tree_->create(NodeKind::AND, decimal2(0), NodeItem("BMW"))
-             ->attach(tree_->create(NodeKind::OR, decimal2(0), NodeItem("Model"))
-                 ->attach(tree_->create(NodeKind::AND, decimal2(2900000), NodeItem("X6"))
-                     ->attach(tree_->create(NodeKind::OR, decimal2(0), NodeItem("Engine"))
-                         ->attach(tree_->create(NodeKind::AND, decimal2(0), NodeItem("Gas"))
-                              ->attach(tree_->create(NodeKind::OR, decimal2(0), NodeItem("Engine power"))
-                                  ->append(NodeKind::NONE, decimal2(503000), NodeItem("306 hp"))
-                                  ->append(NodeKind::NONE, decimal2(1248000), NodeItem("450 hp"))))
-                         ->attach(tree_->create(NodeKind::AND, decimal2(0), NodeItem("Diesel"))
-                              ->attach(tree_->create(NodeKind::OR, decimal2(0), NodeItem("Engine power"))
-                                  ->append(NodeKind::NONE, decimal2(541000), NodeItem("249 hp"))
-                                  ->append(NodeKind::NONE, decimal2(858000), NodeItem("313 hp"))
-                                  ->append(NodeKind::NONE, decimal2(1675000), NodeItem("381 hp")))))
-                     ->attach(tree_->create(NodeKind::AND, decimal2(0), NodeItem("Options"))
-                         ->attach(tree_->create(NodeKind::OR, decimal2(0), NodeItem("Electopackage"))
-                              ->append(NodeKind::NONE, decimal2(30000), NodeItem("Front power windows"))
-                              ->append(NodeKind::NONE, decimal2(210000), NodeItem("Full electropackage")))
-                         ->attach(tree_->create(NodeKind::OR, decimal2(0), NodeItem("Audio system"))
-                              ->append(NodeKind::NONE, decimal2(70000), NodeItem("Harman"))
-                              ->append(NodeKind::NONE, decimal2(190000), NodeItem("Bang & Olufsen")))))
-                ->attach(tree_->create(NodeKind::AND, decimal2(2300000), NodeItem("X5"))
-                    ->attach(tree_->create(NodeKind::OR, decimal2(0), NodeItem("Engine"))
-                        ->attach(tree_->create(NodeKind::AND, decimal2(0), NodeItem("Gas"))
-                             ->attach(tree_->create(NodeKind::OR, decimal2(0), NodeItem("Engine power"))
-                                 ->append(NodeKind::NONE, decimal2(410000), NodeItem("306 hp"))
-                                 ->append(NodeKind::NONE, decimal2(1102000), NodeItem("450 hp"))))
-                        ->attach(tree_->create(NodeKind::AND, decimal2(0), NodeItem("Diesel"))
-                             ->attach(tree_->create(NodeKind::OR, decimal2(0), NodeItem("Engine power"))
-                                 ->append(NodeKind::NONE, decimal2(525000), NodeItem("218 hp"))
-                                 ->append(NodeKind::NONE, decimal2(671000), NodeItem("249 hp"))
-                                 ->append(NodeKind::NONE, decimal2(786000), NodeItem("313 hp"))
-                                 ->append(NodeKind::NONE, decimal2(1259500), NodeItem("381 hp")))))
-                    ->attach(tree_->create(NodeKind::AND, decimal2(0), NodeItem("Options"))
-                        ->attach(tree_->create(NodeKind::OR, decimal2(0), NodeItem("TV"))
-                                 ->append(NodeKind::NONE, decimal2(81017), NodeItem("Yes"))
-                                 ->append(NodeKind::NONE, decimal2(0), NodeItem("No")))
-                        ->attach(tree_->create(NodeKind::OR, decimal2(0), NodeItem("Electopackage"))
-                             ->append(NodeKind::NONE, decimal2(35000), NodeItem("Front power windows"))
-                             ->append(NodeKind::NONE, decimal2(206700), NodeItem("Full electropackage")))
-                        ->attach(tree_->create(NodeKind::OR, decimal2(0), NodeItem("Audio system"))
-                             ->append(NodeKind::NONE, decimal2(34576), NodeItem("Hi-Fi Audio system"))
-                             ->append(NodeKind::NONE, decimal2(76000), NodeItem("Harman"))
-                             ->append(NodeKind::NONE, decimal2(278446), NodeItem("Bang & Olufsen"))))))));*/
+    tree_->setRoot(tree_->create(NodeKind::OR, price_t(0), NodeItem("Mark"))
+         ->attach(tree_->create(NodeKind::AND, price_t(0), NodeItem("BMW"))
+             ->attach(tree_->create(NodeKind::OR, price_t(0), NodeItem("Model"))
+                 ->attach(tree_->create(NodeKind::AND, price_t(2900000), NodeItem("X6"))
+                     ->attach(tree_->create(NodeKind::OR, price_t(0), NodeItem("Engine"))
+                         ->attach(tree_->create(NodeKind::AND, price_t(0), NodeItem("Gas"))
+                              ->attach(tree_->create(NodeKind::OR, price_t(0), NodeItem("Engine power"))
+                                  ->append(NodeKind::NONE, price_t(503000), NodeItem("306 hp"))
+                                  ->append(NodeKind::NONE, price_t(1248000), NodeItem("450 hp"))))
+                         ->attach(tree_->create(NodeKind::AND, price_t(0), NodeItem("Diesel"))
+                              ->attach(tree_->create(NodeKind::OR, price_t(0), NodeItem("Engine power"))
+                                  ->append(NodeKind::NONE, price_t(541000), NodeItem("249 hp"))
+                                  ->append(NodeKind::NONE, price_t(858000), NodeItem("313 hp"))
+                                  ->append(NodeKind::NONE, price_t(1675000), NodeItem("381 hp")))))
+                     ->attach(tree_->create(NodeKind::AND, price_t(0), NodeItem("Options"))
+                         ->attach(tree_->create(NodeKind::OR, price_t(0), NodeItem("Electopackage"))
+                              ->append(NodeKind::NONE, price_t(30000), NodeItem("Front power windows"))
+                              ->append(NodeKind::NONE, price_t(210000), NodeItem("Full electropackage")))
+                         ->attach(tree_->create(NodeKind::OR, price_t(0), NodeItem("Audio system"))
+                              ->append(NodeKind::NONE, price_t(70000), NodeItem("Harman"))
+                              ->append(NodeKind::NONE, price_t(190000), NodeItem("Bang & Olufsen")))))
+                ->attach(tree_->create(NodeKind::AND, price_t(2300000), NodeItem("X5"))
+                    ->attach(tree_->create(NodeKind::OR, price_t(0), NodeItem("Engine"))
+                        ->attach(tree_->create(NodeKind::AND, price_t(0), NodeItem("Gas"))
+                             ->attach(tree_->create(NodeKind::OR, price_t(0), NodeItem("Engine power"))
+                                 ->append(NodeKind::NONE, price_t(410000), NodeItem("306 hp"))
+                                 ->append(NodeKind::NONE, price_t(1102000), NodeItem("450 hp"))))
+                        ->attach(tree_->create(NodeKind::AND, price_t(0), NodeItem("Diesel"))
+                             ->attach(tree_->create(NodeKind::OR, price_t(0), NodeItem("Engine power"))
+                                 ->append(NodeKind::NONE, price_t(525000), NodeItem("218 hp"))
+                                 ->append(NodeKind::NONE, price_t(671000), NodeItem("249 hp"))
+                                 ->append(NodeKind::NONE, price_t(786000), NodeItem("313 hp"))
+                                 ->append(NodeKind::NONE, price_t(1259500), NodeItem("381 hp")))))
+                    ->attach(tree_->create(NodeKind::AND, price_t(0), NodeItem("Options"))
+                        ->attach(tree_->create(NodeKind::OR, price_t(0), NodeItem("TV"))
+                                 ->append(NodeKind::NONE, price_t(81017), NodeItem("Yes"))
+                                 ->append(NodeKind::NONE, price_t(0), NodeItem("No")))
+                        ->attach(tree_->create(NodeKind::OR, price_t(0), NodeItem("Electopackage"))
+                             ->append(NodeKind::NONE, price_t(35000), NodeItem("Front power windows"))
+                             ->append(NodeKind::NONE, price_t(206700), NodeItem("Full electropackage")))
+                        ->attach(tree_->create(NodeKind::OR, price_t(0), NodeItem("Audio system"))
+                             ->append(NodeKind::NONE, price_t(34576), NodeItem("Hi-Fi Audio system"))
+                             ->append(NodeKind::NONE, price_t(76000), NodeItem("Harman"))
+                             ->append(NodeKind::NONE, price_t(278446), NodeItem("Bang & Olufsen"))))))));*/
 
     QString home(qApp->applicationDirPath());
 
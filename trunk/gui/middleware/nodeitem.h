@@ -1,8 +1,23 @@
 ﻿#pragma once
 
-#include "decimal_for_cpp/decimal.h"
+#include <map>
+#include <string>
 
+#include "datamodel/Money.hpp"
 #include "datamodel/SolutionIterator.hpp"
+#include "datamodel/BranchAndBoundIterator.hpp"
+#include "datamodel/WorkStealingPool.hpp"
+#include "datamodel/SolutionSampler.hpp"
+#include "datamodel/PriceDistribution.hpp"
+#include "datamodel/SolutionStream.hpp"
+#include "datamodel/ClosestPriceSearch.hpp"
+#include "datamodel/PriceExtremes.hpp"
+#include "datamodel/ParetoFront.hpp"
+#include "datamodel/BestValueSearch.hpp"
+#include "datamodel/FacetStatistics.hpp"
+#include "datamodel/SolutionDiff.hpp"
+#include "datamodel/BatchPricing.hpp"
+#include "datamodel/FactorizedSolutions.hpp"
 #include "datamodel/AndOrTree.hpp"
 
 namespace vehicle {
@@ -15,6 +30,8 @@ namespace middleware {
 /// \note Цена данного компонента содержится в дереве в качестве ключа.
 /// "Фиксированность" элемента можно изменить в любой момент для пересчета
 /// множества альтернатив, название задается лишь однажды при создании.
+/// Кроме того, компонент может иметь числовые атрибуты (мощность, масса,
+/// расход топлива), которые суммируются по всем компонентам конфигурации.
 ///
 class NodeItem
 {
@@ -41,10 +58,29 @@ public:
     /// \param fixed: true, если зафикисирован, иначе - false
     ///
     inline void setFixed(bool fixed) { fixed_ = fixed; }
+    ///
+    /// \return Значение атрибута \p name, либо 0, если атрибут не задан
+    ///
+    inline double attribute(const std::string& name) const
+    {
+        auto it = attributes_.find(name);
+        return it == attributes_.end() ? 0.0 : it->second;
+    }
+    ///
+    /// \brief Устанавливает значение числового атрибута компонента
+    /// \param name - название атрибута (например, "power")
+    /// \param value - значение атрибута
+    ///
+    inline void setAttribute(const std::string& name, double value) { attributes_[name] = value; }
+    ///
+    /// \return Все атрибуты компонента
+    ///
+    inline const std::map<std::string, double>& attributes() const { return attributes_; }
 
 private:
     std::string name_;
     bool fixed_;
+    std::map<std::string, double> attributes_;
 };
 
 template<typename Stream>
@@ -56,10 +92,42 @@ Stream& operator<<(Stream& os, const NodeItem& value)
     return os;
 }
 
-/// Тип И-ИЛИ дерева с ключом в виде десятичного числа с 2 знаками после запятой.
-typedef core::AndOrTree<decimal2, NodeItem> AOTree;
+/// Тип стоимости: целое число копеек (ранее decimal2, интерфейс совпадает)
+typedef core::money2 price_t;
+/// Тип И-ИЛИ дерева с ключом - стоимостью \see price_t
+typedef core::AndOrTree<price_t, NodeItem> AOTree;
 /// Тип итератора подходящих конфигураций
 typedef algorithm::SolutionIterator<typename AOTree::key_t, typename AOTree::value_t> solution_iterator;
+/// Тип компактного представления конфигурации (индексы выбранных альтернатив)
+typedef typename solution_iterator::view_t solution_view;
+/// Тип итератора конфигураций, стоимость которых попадает в заданный диапазон
+typedef algorithm::BranchAndBoundIterator<typename AOTree::key_t, typename AOTree::value_t> bounded_solution_iterator;
+/// Тип диапазона стоимостей конфигураций
+typedef algorithm::PriceRange<typename AOTree::key_t> price_range;
+/// Тип случайной выборки конфигураций
+typedef algorithm::SolutionSampler<typename AOTree::key_t, typename AOTree::value_t> solution_sampler;
+/// Тип распределения стоимостей конфигураций
+typedef algorithm::PriceDistribution<typename AOTree::key_t, typename AOTree::value_t> price_distribution;
+/// Тип поиска самой дешёвой и самой дорогой конфигураций
+typedef algorithm::PriceExtremes<typename AOTree::key_t, typename AOTree::value_t> price_extremes;
+/// Тип Парето-фронта конфигураций по стоимости и атрибутам компонентов
+typedef algorithm::ParetoFront<typename AOTree::key_t, typename AOTree::value_t> pareto_front;
+/// Тип поиска конфигураций с наибольшим баллом в пределах бюджета
+typedef algorithm::BestValueSearch<typename AOTree::key_t, typename AOTree::value_t> best_value_search;
+/// Тип статистики количества и наименьшей стоимости конфигураций для значений параметров
+typedef algorithm::FacetStatistics<typename AOTree::key_t, typename AOTree::value_t> facet_statistics;
+/// Тип разметки узлов выбора дерева по разрядам
+typedef algorithm::ChoiceLayout<typename AOTree::key_t, typename AOTree::value_t> choice_layout;
+/// Тип разности множеств конфигураций до и после изменения значений параметров
+typedef algorithm::SolutionDiff<typename AOTree::key_t, typename AOTree::value_t> solution_diff;
+/// Тип итератора конфигураций подпространства из разности \see solution_diff
+typedef algorithm::SubspaceIterator<typename AOTree::key_t, typename AOTree::value_t> subspace_iterator;
+/// Тип отбора конфигураций при фиксации новых значений параметров
+typedef algorithm::NarrowingFilter<typename AOTree::key_t, typename AOTree::value_t> narrowing_filter;
+/// Тип пакетного расчёта стоимостей заданных конфигураций
+typedef algorithm::BatchPricing<typename AOTree::key_t, typename AOTree::value_t> batch_pricing;
+/// Тип факторизованного множества конфигураций (произведения независимых групп)
+typedef algorithm::FactorizedSolutions<typename AOTree::key_t, typename AOTree::value_t> factorized_solutions;
 
 } // namespace middleware
 } // namespace vehicle
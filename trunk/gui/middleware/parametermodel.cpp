@@ -15,6 +15,8 @@
 #include <QtCore/QSettings>
 #include <QtCore/QTime>
 
+#include <set>
+
 #include "../utils/xmlparser.h"
 
 #include "treeview.h"
@@ -116,7 +118,7 @@ QString Parameter::value() const
     return value_;
 }
 
-ParameterModel::ParameterModel(AOTree* tree, QObject* parent) : QAbstractListModel(parent), solutionModel_(0), treeModel_(0), changed_(false), tree_(tree), nameSize_(-1)
+ParameterModel::ParameterModel(AOTree* tree, QObject* parent) : QAbstractListModel(parent), solutionModel_(0), treeModel_(0), changed_(false), tree_(tree), nameSize_(-1), priceRangeSet_(false), targetCount_(0), targetPriceSet_(false), updatePending_(false)
 {
     Q_ASSERT(tree_);
 	connect(&paramSet_, SIGNAL(started()), SIGNAL(parameterSetStarted()));
@@ -127,6 +129,8 @@ ParameterModel::ParameterModel(AOTree* tree, QObject* parent) : QAbstractListMod
 
     roles_[ParameterRole] = "Parameter";
     roles_[NameSizeRole] = "NameWidth";
+    roles_[ValueCountsRole] = "ValueCounts";
+    roles_[ValueMinPricesRole] = "ValueMinPrices";
 
 #ifdef _DEBUG
     std::cout << *this << std::endl;
@@ -136,6 +140,8 @@ ParameterModel::ParameterModel(AOTree* tree, QObject* parent) : QAbstractListMod
 ParameterModel::~ParameterModel()
 {
 	paramSet_.waitForFinished();
+    if(updatePending_)
+        delete paramSet_.result();
     delete solutionModel_;
     delete tree_;
     clear();
@@ -144,6 +150,9 @@ ParameterModel::~ParameterModel()
 void ParameterModel::initialize()
 {
     Q_ASSERT(!treeModel_);
+    distribution_.reset();
+    facets_.reset();
+    pricing_.reset();
 
     static std::function<void(Parameter*,const QString&,AOTree::node_t*,ParameterModel*)> expandParameter =
     [](Parameter* parent, const QString& parentValue, AOTree::node_t* node, ParameterModel* model)
@@ -198,9 +207,10 @@ void ParameterModel::initialize()
         unfixNode(root);
         expandParameter(nullptr, "", root, this);
     }
+    layout_ = std::make_shared<const choice_layout>(root);
 
-    solution_iterator it(*tree_);
-    SolutionModel* solutionModel = SolutionModel::create(it, this);
+    // решения строк создаются при обращении к ним, без перебора
+    SolutionModel* solutionModel = SolutionModel::create(std::make_shared<const factorized_solutions>(*tree_), this);
     if(solutionModel_)
     {
         solutionModel_->clear();
@@ -218,6 +228,9 @@ void ParameterModel::initialize()
 void ParameterModel::treeChanged()
 {
     changed_ = true;
+    distribution_.reset();
+    facets_.reset();
+    pricing_.reset();
 }
 
 int ParameterModel::rowCount(const QModelIndex& parent) const
@@ -237,6 +250,22 @@ QVariant ParameterModel::data(const QModelIndex& index, int role) const
         return QVariant::fromValue(actualParams_[index.row()]);
     case ParameterModel::NameSizeRole :
         return nameSize_;
+    case ParameterModel::ValueCountsRole :
+    case ParameterModel::ValueMinPricesRole :
+    {
+        QVariantMap values;
+        auto node = actualParams_[index.row()]->node();
+        for(auto child : *node)
+        {
+            auto& facet = facets().of(child);
+            QString value = QString::fromStdString(child->getValue().name());
+            if(role == ParameterModel::ValueCountsRole)
+                values[value] = static_cast<qulonglong>(facet.count);
+            else if(!facet.empty())
+                values[value] = static_cast<int>(facet.minPrice.getAsInteger());
+        }
+        return values;
+    }
     default :
         Q_UNREACHABLE();
         return QVariant();
@@ -295,7 +324,7 @@ int ParameterModel::parametersCount() const
 
 void ParameterModel::setParameterValue(const QString& name, const QString& value)
 {
-	paramSet_.waitForFinished();
+    applyPendingUpdate();
 
     Parameter* parameter = nullptr;
     for(Parameter* p : actualParams_)
@@ -306,23 +335,337 @@ void ParameterModel::setParameterValue(const QString& name, const QString& value
         }
 
     Q_ASSERT(parameter != nullptr);
+    std::vector<size_t> before = fixedState(*layout_);
     parameter->chooseValue(value);
+    distribution_.reset();
+    facets_.reset();
+    if(rowCount() > 0)
+        emit dataChanged(index(0), index(rowCount() - 1), QVector<int>() << ValueCountsRole << ValueMinPricesRole);
+
+    std::vector<size_t> after = fixedState(*layout_);
 
-	paramSet_.setFuture(QtConcurrent::run(this, &ParameterModel::startUpdateSolutionModel));
+    // без ограничения стоимости и сортировки модель хранит решения
+    // в факторизованном виде: множество строится заново без перебора
+    if(!priceRangeSet_ && !targetPriceSet_ && solutionModel_->isFactorized())
+    {
+        solutionModel_->setSolutions(std::make_shared<const factorized_solutions>(*tree_));
+        return;
+    }
+
+    // фиксация значения только сужает множество решений: уже найденные
+    // решения (все или попадающие в диапазон цен) отбираются без перебора;
+    // модель решений уже обновлена по результату предыдущего перебора
+    // \see applyPendingUpdate()
+    narrowing_filter filter(layout_, before, after);
+    if(filter.isNarrowing() && !targetPriceSet_ && solutionModel_->narrow(filter))
+        return;
+
+    // без ограничения стоимости модель содержит все решения:
+    // достаточно перебрать только изменившиеся
+    updatePending_ = true;
+    if(priceRangeSet_ || targetPriceSet_)
+        paramSet_.setFuture(QtConcurrent::run(this, &ParameterModel::startUpdateSolutionModel));
+    else
+        paramSet_.setFuture(QtConcurrent::run(this, &ParameterModel::startUpdateSolutionDiff,
+                                              diffSolutions(layout_, before, after)));
+}
+
+void ParameterModel::setPriceRange(int minPrice, int maxPrice)
+{
+    applyPendingUpdate();
+
+    priceRange_ = price_range(AOTree::key_t(minPrice), AOTree::key_t(maxPrice));
+    priceRangeSet_ = true;
+    targetPriceSet_ = false;
+
+    updatePending_ = true;
+    paramSet_.setFuture(QtConcurrent::run(this, &ParameterModel::startUpdateSolutionModel));
+}
+
+void ParameterModel::setTargetPrice(int price, int count)
+{
+    applyPendingUpdate();
+
+    targetPrice_ = AOTree::key_t(price);
+    targetCount_ = count;
+    targetPriceSet_ = true;
+    priceRangeSet_ = false;
+
+    updatePending_ = true;
+    paramSet_.setFuture(QtConcurrent::run(this, &ParameterModel::startUpdateSolutionModel));
+}
+
+void ParameterModel::resetPriceRange()
+{
+    applyPendingUpdate();
+
+    if(priceRangeSet_ || targetPriceSet_)
+    {
+        priceRangeSet_ = false;
+        targetPriceSet_ = false;
+        updatePending_ = true;
+        paramSet_.setFuture(QtConcurrent::run(this, &ParameterModel::startUpdateSolutionModel));
+    }
 }
 
 SolutionModel* ParameterModel::startUpdateSolutionModel()
 {
-	solution_iterator it(*tree_);
-    return SolutionModel::create(it);
+    if(priceRangeSet_)
+        return SolutionModel::create(bounded_solution_iterator(*tree_, priceRange_));
+    if(targetPriceSet_)
+        return SolutionModel::create(algorithm::closestSolutions(*tree_, targetPrice_, static_cast<size_t>(qMax(targetCount_, 0))));
+
+    // без ограничения стоимости строки остаются факторизованными (\see setParameterValue)
+    return SolutionModel::create(std::make_shared<const factorized_solutions>(*tree_));
+}
+
+SolutionModel* ParameterModel::startUpdateSolutionDiff(solution_diff diff)
+{
+    return SolutionModel::create(diff);
 }
 
 void ParameterModel::endUpdateSolutionModel()
 {
+    // результат уже применён \see applyPendingUpdate()
+    if(!updatePending_)
+        return;
+    updatePending_ = false;
 	solutionModel_->recomputeToFit(paramSet_.result());
     delete paramSet_.result();
 }
 
+void ParameterModel::applyPendingUpdate()
+{
+    paramSet_.waitForFinished();
+    // перебор завершился, но сигнал finished ещё не обработан: новая задача
+    // отбросит этот сигнал, а изменения (\see startUpdateSolutionDiff())
+    // применяются к модели по порядку, поэтому результат применяется сразу
+    if(updatePending_)
+        endUpdateSolutionModel();
+}
+
+const price_distribution& ParameterModel::distribution() const
+{
+    if(!distribution_)
+        distribution_.reset(new price_distribution(*tree_));
+    return *distribution_;
+}
+
+const facet_statistics& ParameterModel::facets() const
+{
+    if(!facets_)
+        facets_.reset(new facet_statistics(*tree_));
+    return *facets_;
+}
+
+const batch_pricing& ParameterModel::pricing() const
+{
+    if(!pricing_)
+        pricing_.reset(new batch_pricing(*tree_, [](const NodeItem& item) { return item.name(); }));
+    return *pricing_;
+}
+
+QVariantList ParameterModel::priceHistogram(int bands) const
+{
+    QVariantList histogram;
+    if(distribution().empty() || bands <= 0)
+        return histogram;
+
+    for(auto& bucket : distribution().histogram(static_cast<size_t>(bands)))
+    {
+        QVariantMap band;
+        band["from"] = static_cast<int>(bucket.from.getAsInteger());
+        band["to"] = static_cast<int>(bucket.to.getAsInteger());
+        band["count"] = static_cast<qulonglong>(bucket.count);
+        histogram.append(band);
+    }
+    return histogram;
+}
+
+qulonglong ParameterModel::countWithinBudget(int maxPrice) const
+{
+    return distribution().countAtMost(AOTree::key_t(maxPrice));
+}
+
+qulonglong ParameterModel::countInPriceRange(int minPrice, int maxPrice) const
+{
+    return distribution().countWithin(price_range(AOTree::key_t(minPrice), AOTree::key_t(maxPrice)));
+}
+
+QVariantList ParameterModel::modelPrices() const
+{
+    QVariantList prices;
+    auto root = tree_->getRoot();
+    if(!root || !algorithm::hasChoice(root))
+        return prices;
+
+    price_extremes extremes(*tree_);
+    for(auto markNode : *root)
+    {
+        if(markNode->childCount() == 0 || !algorithm::hasChoice(markNode->child(0)))
+            continue;
+
+        for(auto modelNode : *markNode->child(0))
+        {
+            // модель исключена зафиксированными значениями параметров
+            auto cheapest = extremes.cheapest(modelNode);
+            if(!cheapest.root())
+                continue;
+
+            QVariantMap model;
+            model["mark"] = QString::fromStdString(markNode->getValue().name());
+            model["model"] = QString::fromStdString(modelNode->getValue().name());
+            model["from"] = static_cast<int>(cheapest.totalPrice().getAsInteger());
+            model["to"] = static_cast<int>(extremes.mostExpensive(modelNode).totalPrice().getAsInteger());
+            prices.append(model);
+        }
+    }
+    return prices;
+}
+
+QVariantList ParameterModel::priceConfigurations(const QVariantList& configurations) const
+{
+    std::vector<std::vector<std::string>> orders;
+    orders.reserve(configurations.size());
+    for(auto& configuration : configurations)
+    {
+        std::vector<std::string> order;
+        for(auto& path : configuration.toStringList())
+            order.push_back(path.toStdString());
+        orders.push_back(qMove(order));
+    }
+
+    QVariantList quotes;
+    for(auto& quote : pricing().price(orders))
+    {
+        QVariantMap item;
+        item["valid"] = quote.isValid();
+        item["status"] = static_cast<int>(quote.status);
+        item["price"] = quote.isValid() ? static_cast<int>(quote.price.getAsInteger()) : 0;
+        quotes.append(item);
+    }
+    return quotes;
+}
+
+QVariantList ParameterModel::summary() const
+{
+    QVariantList rows;
+    auto root = tree_->getRoot();
+    if(!root || !algorithm::hasChoice(root))
+        return rows;
+
+    auto appendRow = [&rows](const AOTree::node_t* markNode, const AOTree::node_t* modelNode, const facet_statistics::facet_t& facet)
+    {
+        QVariantMap row;
+        row["mark"] = QString::fromStdString(markNode->getValue().name());
+        row["model"] = modelNode ? QString::fromStdString(modelNode->getValue().name()) : QString();
+        row["count"] = static_cast<qulonglong>(facet.count);
+        row["from"] = static_cast<int>(facet.minPrice.getAsInteger());
+        row["to"] = static_cast<int>(facet.maxPrice.getAsInteger());
+        rows.append(row);
+    };
+
+    for(auto markNode : *root)
+    {
+        auto markFacet = facets().current(markNode);
+        if(markFacet.empty())
+            continue;
+        appendRow(markNode, nullptr, markFacet);
+
+        if(markNode->childCount() == 0 || !algorithm::hasChoice(markNode->child(0)))
+            continue;
+        for(auto modelNode : *markNode->child(0))
+        {
+            auto modelFacet = facets().current(modelNode);
+            if(!modelFacet.empty())
+                appendRow(markNode, modelNode, modelFacet);
+        }
+    }
+    return rows;
+}
+
+QVariantList ParameterModel::paretoFront(const QStringList& maximize, const QStringList& minimize) const
+{
+    QStringList names;
+    std::vector<pareto_front::criterion_t> criteria;
+    for(auto& name : maximize)
+    {
+        std::string attribute = name.toStdString();
+        criteria.push_back(pareto_front::criterion_t([attribute](const NodeItem& item) { return item.attribute(attribute); }, algorithm::Goal::Maximize));
+        names.append(name);
+    }
+    for(auto& name : minimize)
+    {
+        std::string attribute = name.toStdString();
+        criteria.push_back(pareto_front::criterion_t([attribute](const NodeItem& item) { return item.attribute(attribute); }, algorithm::Goal::Minimize));
+        names.append(name);
+    }
+
+    QVariantList front;
+    pareto_front optimal(*tree_, qMove(criteria));
+    for(auto& solution : optimal.solutions())
+    {
+        Solution description(solution.solution);
+        QVariantMap attributes;
+        for(int i = 0; i < names.size(); ++i)
+            attributes[names[i]] = solution.attributes[i];
+
+        QVariantMap item;
+        item["mark"] = description.mark();
+        item["model"] = description.model();
+        item["description"] = description.shortDescription();
+        item["price"] = static_cast<int>(solution.price().getAsInteger());
+        item["attributes"] = attributes;
+        front.append(item);
+    }
+    return front;
+}
+
+QVariantList ParameterModel::bestValue(int budget, int count) const
+{
+    QVariantList configurations;
+    if(count <= 0)
+        return configurations;
+
+    best_value_search search(*tree_, [](const NodeItem& item) { return qRound64(item.attribute("score")); });
+    for(auto& solution : search.find(AOTree::key_t(budget), static_cast<size_t>(count)))
+    {
+        Solution description(solution.solution);
+        QVariantMap item;
+        item["mark"] = description.mark();
+        item["model"] = description.model();
+        item["description"] = description.shortDescription();
+        item["price"] = static_cast<int>(solution.price().getAsInteger());
+        item["score"] = static_cast<qlonglong>(solution.score);
+        configurations.append(item);
+    }
+    return configurations;
+}
+
+QVariantList ParameterModel::sampleSolutions(int count, uint seed) const
+{
+    QVariantList configurations;
+    solution_sampler sampler(*tree_, seed);
+    if(count <= 0 || !sampler.hasSolution())
+        return configurations;
+
+    std::set<std::vector<size_t>> sampled;
+    for(auto& solution : sampler.sample(static_cast<size_t>(count)))
+    {
+        if(!sampled.insert(solution.choiceIndices()).second)
+            continue;
+
+        Solution description(solution);
+        QVariantMap item;
+        item["mark"] = description.mark();
+        item["model"] = description.model();
+        item["description"] = description.shortDescription();
+        item["price"] = static_cast<int>(description.price().getAsInteger());
+        configurations.append(item);
+    }
+    return configurations;
+}
+
 SolutionModel* ParameterModel::solutionModel() const
 {
     return solutionModel_;
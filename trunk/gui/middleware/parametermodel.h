@@ -2,6 +2,9 @@
 
 #include <QtCore/QAbstractListModel>
 #include <QtCore/QFutureWatcher>
+#include <QtCore/QScopedPointer>
+
+#include <memory>
 
 #include "nodeitem.h"
 
@@ -112,6 +115,11 @@ public:
     /// \return true, если параметр виден и должен быть отображен в GUI
     ///
     inline bool isVisible() const { return visible_; }
+    ///
+    /// \brief Возвращает узел ИЛИ исходного дерева, значения
+    /// которого представляет параметр
+    ///
+    inline const AOTree::node_t* node() const { return node_; }
 
 signals:
     void visibilityChanged();
@@ -167,6 +175,8 @@ public:
     enum ParameterRoles {
         ParameterRole = Qt::UserRole + 1,
         NameSizeRole,
+        ValueCountsRole,
+        ValueMinPricesRole,
     };
 
     ///
@@ -187,7 +197,10 @@ public:
     /// \brief Определение чисто виртуального метода базового класса
     /// \param index - cтрока индекса должна быть >= 0 и < кол-ва строка \see rowCount()
     /// \param role - может быть любым значением перечисления \e ParameterRoles
-    /// \return Возвращает данные по индексу \p index для заданной роли \p role
+    /// \return Возвращает данные по индексу \p index для заданной роли \p role.
+    /// Для ролей ValueCountsRole и ValueMinPricesRole - словарь, сопоставляющий
+    /// каждому значению параметра количество конфигураций и наименьшую стоимость
+    /// при выборе этого значения (вместо текущего) \see algorithm::FacetStatistics
     ///
     QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
 
@@ -217,6 +230,92 @@ public:
     ///
     Q_INVOKABLE void openEditMode();
 
+    ///
+    /// \brief Возвращает гистограмму стоимостей конфигураций
+    /// при текущих значениях параметров, рассчитанную без перебора
+    /// конфигураций \see algorithm::PriceDistribution
+    /// \param bands - количество ценовых диапазонов
+    /// \return Список диапазонов вида { "from", "to", "count" }
+    /// \note Метод вызывается из QML
+    ///
+    Q_INVOKABLE QVariantList priceHistogram(int bands) const;
+    ///
+    /// \brief Возвращает количество конфигураций при текущих значениях
+    /// параметров, стоимость которых не превышает бюджет \p maxPrice.
+    /// Конфигурации не перебираются, поэтому значение можно показывать
+    /// рядом с ползунком бюджета при каждом его изменении
+    /// \note Метод вызывается из QML
+    ///
+    Q_INVOKABLE qulonglong countWithinBudget(int maxPrice) const;
+    ///
+    /// \brief Возвращает количество конфигураций при текущих значениях
+    /// параметров, стоимость которых попадает в диапазон [\p minPrice, \p maxPrice]
+    /// \note Метод вызывается из QML
+    ///
+    Q_INVOKABLE qulonglong countInPriceRange(int minPrice, int maxPrice) const;
+    ///
+    /// \brief Возвращает цены "от" и "до" для каждой модели при текущих
+    /// значениях параметров. Самая дешёвая и самая дорогая конфигурации
+    /// модели восстанавливаются без перебора \see algorithm::PriceExtremes
+    /// \return Список моделей вида { "mark", "model", "from", "to" }
+    /// \note Метод вызывается из QML
+    ///
+    Q_INVOKABLE QVariantList modelPrices() const;
+    ///
+    /// \brief Возвращает сводку по маркам и моделям при текущих значениях
+    /// параметров: количество конфигураций, цены "от" и "до". Рассчитывается
+    /// вместе со статистикой значений параметров, без перебора \see facets()
+    /// \return Список вида { "mark", "model", "count", "from", "to" }:
+    /// строка марки (с пустым "model"), за ней строки её моделей;
+    /// исключённые зафиксированными значениями марки и модели пропускаются
+    /// \note Метод вызывается из QML
+    ///
+    Q_INVOKABLE QVariantList summary() const;
+    ///
+    /// \brief Рассчитывает стоимости заданных конфигураций (заказы дилеров,
+    /// импорт из CRM) без перебора и без построения дерева на каждую
+    /// \param configurations - список конфигураций; конфигурация - список
+    /// путей к выбранным значениям вида "BMW/X6/Двигатель/3.0d"
+    /// \return Список вида { "valid", "status", "price" } в порядке конфигураций;
+    /// "status" - значение \see algorithm::QuoteStatus
+    /// \see algorithm::BatchPricing
+    ///
+    Q_INVOKABLE QVariantList priceConfigurations(const QVariantList& configurations) const;
+    ///
+    /// \brief Возвращает Парето-оптимальные конфигурации при текущих значениях
+    /// параметров по стоимости и числовым атрибутам компонентов, рассчитанные
+    /// без перебора всех конфигураций \see algorithm::ParetoFront
+    /// \param maximize - атрибуты, которые нужно увеличивать (например, "power")
+    /// \param minimize - атрибуты, которые нужно уменьшать (например, "weight")
+    /// \return Список конфигураций вида { "mark", "model", "description", "price", "attributes" }
+    /// по возрастанию стоимости, где "attributes" - значения атрибутов по их названиям
+    /// \note Метод вызывается из QML
+    ///
+    Q_INVOKABLE QVariantList paretoFront(const QStringList& maximize, const QStringList& minimize) const;
+    ///
+    /// \brief Возвращает \p count конфигураций с наибольшим суммарным баллом
+    /// компонентов (атрибут "score", округляется до целого) при текущих
+    /// значениях параметров, стоимость которых не превышает \p budget
+    /// \see algorithm::BestValueSearch
+    /// \return Список конфигураций вида { "mark", "model", "description", "price", "score" }
+    /// по убыванию балла
+    /// \note Метод вызывается из QML
+    ///
+    Q_INVOKABLE QVariantList bestValue(int budget, int count) const;
+    ///
+    /// \brief Возвращает случайную выборку конфигураций при текущих значениях
+    /// параметров, когда их слишком много для полного списка (например,
+    /// для сравнения представительного набора) \see algorithm::SolutionSampler
+    /// \param count - количество выбираемых конфигураций; повторы отбрасываются,
+    /// поэтому конфигураций может оказаться меньше
+    /// \param seed - начальное значение генератора: выборка с тем же значением
+    /// повторяется
+    /// \return Список конфигураций вида { "mark", "model", "description", "price" }
+    /// в порядке выбора
+    /// \note Метод вызывается из QML
+    ///
+    Q_INVOKABLE QVariantList sampleSolutions(int count, uint seed) const;
+
 public slots:
     ///
     /// \brief Устанавливается текущее значение заданного параметра \see Parameter::chooseValue()
@@ -225,6 +324,27 @@ public slots:
     /// \note Метод вызывается из QML при изменении значений параметров
     ///
     void setParameterValue(const QString& name, const QString& value);
+    ///
+    /// \brief Ограничивает модель решений конфигурациями,
+    /// стоимость которых попадает в диапазон [\p minPrice, \p maxPrice].
+    /// Конфигурации, не попадающие в диапазон, не перебираются
+    /// \see algorithm::BranchAndBoundIterator
+    /// \note Метод вызывается из QML при изменении бюджета
+    ///
+    void setPriceRange(int minPrice, int maxPrice);
+    ///
+    /// \brief Ограничивает модель решений \p count конфигурациями,
+    /// стоимость которых ближе всего к \p price ("около 4.5 млн"),
+    /// в порядке возрастания отклонения от \p price
+    /// \see algorithm::ClosestPriceSearch
+    /// \note Заменяет ограничение \see setPriceRange() и наоборот
+    ///
+    void setTargetPrice(int price, int count);
+    ///
+    /// \brief Снимает ограничение на стоимость конфигураций
+    /// \see setPriceRange(), \see setTargetPrice()
+    ///
+    void resetPriceRange();
 
 signals:
 	///
@@ -240,6 +360,7 @@ signals:
 
 private slots:
 	SolutionModel* startUpdateSolutionModel();
+    SolutionModel* startUpdateSolutionDiff(solution_diff diff);
 	void endUpdateSolutionModel();
     void treeChanged();
 
@@ -248,6 +369,14 @@ protected:
     void addParameter(Parameter* parameter);
     void initialize();
     void clear();
+    ///
+    /// \brief Дожидается завершения перебора и применяет его результат
+    /// к модели решений, если он ещё не применён \see endUpdateSolutionModel()
+    ///
+    void applyPendingUpdate();
+    const price_distribution& distribution() const;
+    const facet_statistics& facets() const;
+    const batch_pricing& pricing() const;
 
 private:
     SolutionModel* solutionModel_;
@@ -261,6 +390,30 @@ private:
     AOTree* tree_;
     int nameSize_;
     bool changed_;
+
+    price_range priceRange_;
+    bool priceRangeSet_;
+
+    AOTree::key_t targetPrice_;
+    int targetCount_;
+    bool targetPriceSet_;
+    /// Перебор запущен, и модель решений ещё не обновлена по его результату;
+    /// значение меняется только в потоке GUI: перед запуском перебора
+    /// и в \see endUpdateSolutionModel()
+    bool updatePending_;
+
+    /// Распределение стоимостей при текущих значениях параметров
+    /// (рассчитывается по запросу \see distribution())
+    mutable QScopedPointer<price_distribution> distribution_;
+    /// Статистика значений параметров при текущих значениях параметров
+    /// (рассчитывается по запросу \see facets())
+    mutable QScopedPointer<facet_statistics> facets_;
+    /// Индексы для расчёта стоимостей заданных конфигураций; не зависят
+    /// от значений параметров (рассчитываются по запросу \see pricing())
+    mutable QScopedPointer<batch_pricing> pricing_;
+    /// Разметка узлов выбора дерева для расчёта изменений множества
+    /// решений при изменении значений параметров \see setParameterValue()
+    std::shared_ptr<const choice_layout> layout_;
 };
 
 template<typename Stream>
@@ -1,5 +1,4 @@
 ﻿#include <QtCore/QCryptographicHash>
-#include <QtCore/QLocale>
 
 #include <QtPrintSupport/QPrintDialog>
 #include <QtPrintSupport/QPrinter>
@@ -10,13 +9,27 @@
 #include <QtGui/QTextDocument>
 #include <QtGui/QFontMetrics>
 
+#include <algorithm>
+#include <climits>
+
+#include "../utils/currencyformatter.h"
 #include "../utils/xmlparser.h"
 #include "solutionmodel.h"
 
 namespace vehicle {
 namespace middleware {
 
-Solution::Solution(solution_iterator::solution_tree_t solution)
+namespace {
+
+///
+/// \brief Наибольшее количество решений факторизованного множества,
+/// которое сортируется: для сортировки создаются все решения строк
+///
+const quint64 maxSortedSolutions = 100000;
+
+}
+
+Solution::Solution(const solution_view& solution)
 {
     initialize(solution);
 }
@@ -39,43 +52,40 @@ Solution::Solution(const Solution& solution)
     data_.model = solution.model();
     data_.mark = solution.mark();
     data_.hash = solution.hash();
+    data_.choices = solution.choiceIndices();
 }
 
-void Solution::initialize(solution_iterator::solution_tree_t solution)
+void Solution::initialize(const solution_view& solution)
 {
-    auto root = solution.getRoot();
+    auto root = solution.root();
 
-    auto markNode = root->getValue();
-    Q_ASSERT(markNode.hasChoice);
-    data_.mark = QString::fromStdString(markNode.node->child(markNode.index)->getValue().name());
+    Q_ASSERT(algorithm::hasChoice(root));
+    auto markNode = solution.chosenChild(root);
+    data_.mark = QString::fromStdString(markNode->getValue().name());
 
-    auto modelNode = root->child(markNode.index)->child(0)->getValue();
-    Q_ASSERT(modelNode.hasChoice);
-    data_.model = QString::fromStdString(modelNode.node->child(modelNode.index)->getValue().name());
+    auto modelNode = markNode->child(0);
+    Q_ASSERT(algorithm::hasChoice(modelNode));
+    data_.model = QString::fromStdString(solution.chosenChild(modelNode)->getValue().name());
 
-    data_.price = root->subtreeKey();
+    data_.price = solution.totalPrice();
+    data_.choices = solution.choiceIndices();
     data_.shortDescription.clear();
     data_.fullDescription.clear();
+    data_.hash = hashOf(solution);
 
-    QByteArray hash;
-    hash.append(data_.mark);
-    hash.append(data_.model);
-
-    static std::function<void(const solution_iterator::solution_node_t*, QStringList*, QString*, QByteArray*)> expandNode =
-    [](const solution_iterator::solution_node_t* node, QStringList* model, QString* detailed, QByteArray* hash)
+    // не static: решения создаются параллельно (\see SolutionModel::appendSolutions())
+    std::function<void(const AOTree::node_t*, QStringList*, QString*)> expandNode;
+    expandNode = [&expandNode, &solution](const AOTree::node_t* node, QStringList* model, QString* detailed)
     {
-        Q_ASSERT(node && model && hash);
+        Q_ASSERT(node && model);
 
-        auto choice = node->getValue();
-        auto childNode = node;
-        if(choice.hasChoice)
+        if(algorithm::hasChoice(node))
         {
-            childNode = node->child(choice.index);
-            QString name = QString::fromStdString(choice.node->getValue().name());
-            QString value = QString::fromStdString(childNode->getValue().node->getValue().name());
-            int price = childNode->getValue().node->ownKey().getAsInteger();
-            model->append("<b>" + name + "</b>: " + value + (price > 0 ? " (" + QLocale().toCurrencyString(price) + ")" : ""));
-            hash->append(name + value);
+            auto childNode = solution.chosenChild(node);
+            QString name = QString::fromStdString(node->getValue().name());
+            QString value = QString::fromStdString(childNode->getValue().name());
+            qlonglong price = childNode->ownKey().getAsInteger();
+            model->append("<b>" + name + "</b>: " + value + (price > 0 ? " (" + utils::CurrencyFormatter::instance().format(price) + ")" : ""));
 
             // skip mark and model in a short description
             if(model->size() > 1)
@@ -84,33 +94,75 @@ void Solution::initialize(solution_iterator::solution_tree_t solution)
                 *detailed = QFontMetrics(QGuiApplication::font()).elidedText(*detailed, Qt::ElideRight, 500);
             }
 
-            expandNode(childNode, model, detailed, hash);
+            expandNode(childNode, model, detailed);
         }
         else
-            for(auto child : *childNode)
-                expandNode(child, model, detailed, hash);
+            for(auto child : *node)
+                expandNode(child, model, detailed);
     };
 
-    expandNode(root->child(root->getValue().index), &data_.fullDescription, &data_.shortDescription, &hash);
-    data_.hash = QCryptographicHash::hash(hash, QCryptographicHash::Sha1).toHex();
+    expandNode(markNode, &data_.fullDescription, &data_.shortDescription);
+}
+
+QByteArray Solution::hashOf(const solution_view& solution)
+{
+    auto root = solution.root();
+    auto markNode = solution.chosenChild(root);
+
+    QByteArray hash;
+    hash.append(QString::fromStdString(markNode->getValue().name()));
+    hash.append(QString::fromStdString(solution.chosenChild(markNode->child(0))->getValue().name()));
+
+    // параметры (узлы выбора под маркой) в порядке обхода
+    solution.walk([&solution, &hash, root](const AOTree::node_t* node)
+    {
+        if(node != root && algorithm::hasChoice(node))
+            hash.append(QString::fromStdString(node->getValue().name()) +
+                        QString::fromStdString(solution.chosenChild(node)->getValue().name()));
+    });
+    return QCryptographicHash::hash(hash, QCryptographicHash::Sha1).toHex();
+}
+
+SolutionModel* SolutionModel::create(const std::vector<solution_view>& solutions, QObject* parent)
+{
+    SolutionModel* model = new SolutionModel(parent);
+    model->appendSolutions(solutions);
+    return model;
 }
 
-SolutionModel* SolutionModel::create(solution_iterator solutions, QObject* parent)
+SolutionModel* SolutionModel::create(const solution_diff& diff, QObject* parent)
 {
     SolutionModel* model = new SolutionModel(parent);
-    if(solutions.solutionCount())
+    model->diff_ = true;
+    for(auto& subspace : diff.removed)
+    {
+        subspace_iterator solutions(subspace);
+        algorithm::forEachSolution(solutions, [model](const subspace_iterator& it) {
+            model->removedHashes_.insert(Solution::hashOf(it.currentView()));
+            return true;
+        });
+    }
+    std::vector<solution_view> added;
+    for(auto& subspace : diff.added)
     {
-        do {
-            Solution* solution = new Solution(solutions.currentSolution());
-			//Q_ASSERT(!model->solutionsHash_.contains(solution->hash()));
-			model->solutionsHash_[solution->hash()] = solution;
-			model->solutions_.push_back(solution);
-        } while(solutions.nextSolution());
+        subspace_iterator solutions(subspace);
+        algorithm::forEachSolution(solutions, [&added](const subspace_iterator& it) {
+            added.push_back(it.currentView());
+            return true;
+        });
     }
+    model->appendSolutions(added);
+    return model;
+}
+
+SolutionModel* SolutionModel::create(std::shared_ptr<const factorized_solutions> solutions, QObject* parent)
+{
+    SolutionModel* model = new SolutionModel(parent);
+    model->factorized_ = qMove(solutions);
     return model;
 }
 
-SolutionModel::SolutionModel(QObject* parent) : QAbstractListModel(parent), sortOrder_(-1), tempModel_(nullptr), tempMode_(false), outdated_(false)
+SolutionModel::SolutionModel(QObject* parent) : QAbstractListModel(parent), sortOrder_(-1), tempModel_(nullptr), tempMode_(false), diff_(false), factorizedRows_(1000), outdated_(false)
 {
 	connect(&sorting_, SIGNAL(started()), SIGNAL(sortingStarted()));
 	connect(&sorting_, SIGNAL(finished()), SLOT(endSorting()));
@@ -136,6 +188,36 @@ void SolutionModel::recomputeToFit(SolutionModel* model)
     // Новая модель не должна быть отсортирована
     Q_ASSERT(model->sortOrder_ == -1);
 
+    // Факторизованное множество принимается целиком, сортированная
+    // модель сортируется заново в фоне \see sort()
+    if(model->isFactorized())
+    {
+        int order = sortOrder_;
+        setSolutions(model->factorized_);
+        if(order != -1)
+            sort(0, static_cast<Qt::SortOrder>(order));
+        return;
+    }
+
+    // Факторизованная модель не сортирована: строки заменяются решениями
+    // новой модели без создания всех решений множества
+    if(isFactorized())
+    {
+        Q_ASSERT(!model->diff_);
+        sorting_.waitForFinished();
+        beginResetModel();
+        factorizedRows_.clear();
+        factorized_.reset();
+        for(Solution* solution : model->solutions_)
+        {
+            Solution* copy = new Solution(*solution);
+            solutionsHash_[copy->hash()] = copy;
+            solutions_.push_back(copy);
+        }
+        endResetModel();
+        return;
+    }
+
     // Сортируем ее в соответствии с текущей моделью
     if(sortOrder_ != model->sortOrder_)
         model->sort(0, static_cast<Qt::SortOrder>(sortOrder_));
@@ -144,7 +226,9 @@ void SolutionModel::recomputeToFit(SolutionModel* model)
     int row = 0;
     while(it != solutions_.end())
     {
-        if(!model->solutionsHash_.contains(solutions_[row]->hash()))
+        bool removed = model->diff_ ? model->removedHashes_.contains(solutions_[row]->hash())
+                                    : !model->solutionsHash_.contains(solutions_[row]->hash());
+        if(removed)
         {
             solutionsHash_.remove(solutions_[row]->hash());
             beginRemoveRows(QModelIndex(), row, row);
@@ -165,9 +249,107 @@ void SolutionModel::recomputeToFit(SolutionModel* model)
             addSolution(new Solution(*model->solutions_[i]));
 }
 
+bool SolutionModel::narrow(const narrowing_filter& filter)
+{
+    Q_ASSERT(!tempMode_);
+    Q_ASSERT(filter.isNarrowing());
+    sorting_.waitForFinished();
+    if(isFactorized())
+        return false;
+
+    for(Solution* solution : solutions_)
+        if(solution->choiceIndices().empty())
+            return false;
+
+    // удаляем подряд идущие исключённые решения одним диапазоном строк
+    int row = 0;
+    while(row < solutions_.size())
+    {
+        if(filter.accepts(solutions_[row]->choiceIndices()))
+        {
+            ++row;
+            continue;
+        }
+        int last = row;
+        while(last + 1 < solutions_.size() && !filter.accepts(solutions_[last + 1]->choiceIndices()))
+            ++last;
+
+        beginRemoveRows(QModelIndex(), row, last);
+        for(int i = row; i <= last; ++i)
+        {
+            solutionsHash_.remove(solutions_[i]->hash());
+            delete solutions_[i];
+        }
+        solutions_.remove(row, last - row + 1);
+        endRemoveRows();
+    }
+    return true;
+}
+
+void SolutionModel::setSolutions(std::shared_ptr<const factorized_solutions> solutions)
+{
+    Q_ASSERT(!tempMode_);
+    sorting_.waitForFinished();
+
+    beginResetModel();
+    qDeleteAll(solutions_);
+    qDeleteAll(sortedRows_);
+    sortedRows_.clear();
+    solutionsHash_.clear();
+    solutions_.clear();
+    factorizedRows_.clear();
+    factorized_ = qMove(solutions);
+    sortOrder_ = -1;
+    endResetModel();
+}
+
+Solution* SolutionModel::solutionAt(int row) const
+{
+    if(!factorized_)
+        return solutions_[row];
+
+    Solution* solution = factorizedRows_.object(row);
+    if(!solution)
+    {
+        solution = new Solution(factorized_->at(static_cast<quint64>(row)));
+        factorizedRows_.insert(row, solution);
+    }
+    return solution;
+}
+
+std::vector<Solution*> SolutionModel::createSolutions(const std::vector<solution_view>& views)
+{
+    // описание и хеш решения - самая затратная часть построения модели,
+    // поэтому решения создаются частями в нескольких потоках; частей
+    // больше, чем потоков, чтобы неравномерные части выравнивались перехватом
+    std::vector<Solution*> created(views.size());
+    algorithm::WorkStealingPool pool;
+    size_t parts = std::min(views.size(), pool.size() * 8);
+    pool.run(parts, [&views, &created, parts](size_t part)
+    {
+        size_t end = views.size() * (part + 1) / parts;
+        for(size_t i = views.size() * part / parts; i < end; ++i)
+            created[i] = new Solution(views[i]);
+    });
+    return created;
+}
+
+void SolutionModel::appendSolutions(const std::vector<solution_view>& views)
+{
+    for(Solution* solution : createSolutions(views))
+    {
+        solutionsHash_[solution->hash()] = solution;
+        solutions_.push_back(solution);
+    }
+}
+
 int SolutionModel::rowCount(const QModelIndex& parent) const
 {
-    return tempMode_ ? tempModel_->rowCount(parent) : solutions_.count();
+    if(tempMode_)
+        return tempModel_->rowCount(parent);
+    if(factorized_)
+        return static_cast<int>(qMin<quint64>(factorized_->count(), INT_MAX));
+    return solutions_.count();
 }
 
 void SolutionModel::sort(int column, Qt::SortOrder order)
@@ -181,11 +363,35 @@ void SolutionModel::sort(int column, Qt::SortOrder order)
     }
 
 	if(column == 0 && sortOrder_ != order)
+	{
+        // решения строк факторизованного множества создаются в фоне
+        // вместе с сортировкой, слишком большое множество не сортируется
+        if(isFactorized() && factorized_->count() > maxSortedSolutions)
+            return;
 		sorting_.setFuture(QtConcurrent::run(this, &SolutionModel::startSorting, column, order));
+	}
 }
 
 void SolutionModel::startSorting(int column, Qt::SortOrder order)
 {
+    // Строки заменяются созданными решениями в endSorting()
+    if(isFactorized())
+    {
+        std::vector<solution_view> views;
+        views.reserve(static_cast<size_t>(factorized_->count()));
+        for(quint64 i = 0; i < factorized_->count(); ++i)
+            views.push_back(factorized_->at(i));
+
+        std::vector<Solution*> created = createSolutions(views);
+        std::stable_sort(created.begin(), created.end(), [order](const Solution* a, const Solution* b)
+        {
+            return order == Qt::AscendingOrder ? a->price() < b->price() : b->price() < a->price();
+        });
+        sortedRows_ = QVector<Solution*>::fromStdVector(created);
+        sortOrder_ = order;
+        return;
+    }
+
 	// Значит сортировка уже производилась и необходимо инвертировать массив
     if(sortOrder_ != -1)
 		std::reverse(solutions_.begin(), solutions_.end());
@@ -221,6 +427,15 @@ void SolutionModel::startSorting(int column, Qt::SortOrder order)
 void SolutionModel::endSorting()
 {
 	beginResetModel();
+    if(isFactorized() && sortOrder_ != -1)
+    {
+        factorizedRows_.clear();
+        factorized_.reset();
+        solutions_ = sortedRows_;
+        sortedRows_.clear();
+        for(Solution* solution : solutions_)
+            solutionsHash_[solution->hash()] = solution;
+    }
 	endResetModel();
 }
 
@@ -235,17 +450,17 @@ QVariant SolutionModel::data(const QModelIndex& index, int role) const
     switch(role)
     {
     case SolutionModel::ShortDescriptionRole :
-        return solutions_[index.row()]->shortDescription();
+        return solutionAt(index.row())->shortDescription();
     case SolutionModel::FullDescriptionRole :
-        return solutions_[index.row()]->fullDescription();
+        return solutionAt(index.row())->fullDescription();
     case SolutionModel::PriceRole :
-        return solutions_[index.row()]->price().getAsInteger();
+        return solutionAt(index.row())->price().getAsInteger();
     case SolutionModel::ModelRole :
-        return solutions_[index.row()]->model();
+        return solutionAt(index.row())->model();
     case SolutionModel::MarkRole :
-        return solutions_[index.row()]->mark();
+        return solutionAt(index.row())->mark();
     case SolutionModel::HashRole :
-        return solutions_[index.row()]->hash();
+        return solutionAt(index.row())->hash();
     default :
         Q_UNREACHABLE();
         return QVariant();
@@ -255,6 +470,7 @@ QVariant SolutionModel::data(const QModelIndex& index, int role) const
 void SolutionModel::addSolution(Solution* solution)
 {
     Q_ASSERT(!tempMode_);
+    Q_ASSERT(!isFactorized());
     //Q_ASSERT(!solutionsHash_.contains(solution->hash()));
 
     if(sortOrder_ != -1)
@@ -365,7 +581,7 @@ bool SolutionModel::save(const QUrl& file)
 
 bool SolutionModel::saveSolution(int index, const QUrl& file)
 {
-    if(index < 0 || index >= solutions_.size())
+    if(index < 0 || index >= rowCount())
     {
         lastError_ = tr("Cannot save configuration: incorrect index %1").arg(index);
         return false;
@@ -377,7 +593,7 @@ bool SolutionModel::saveSolution(int index, const QUrl& file)
             tr("Configuration ID:") + " %2<br>" + tr("Price:") + " %3</h2></font></p>"
             "<h3><table><caption>" + tr("Parameters:") + "</caption>%4</table></h3></body>");
 
-    Solution* solution = solutions_[index];
+    Solution* solution = solutionAt(index);
     QStringList params = solution->fullDescription().toStringList();
     QString table;
     for(const QString& param : params)
@@ -396,7 +612,7 @@ bool SolutionModel::saveSolution(int index, const QUrl& file)
     QTextDocument document;
     document.setHtml(htmlTemplate.arg(solution->mark() + " " + solution->model())
                                  .arg(solution->hash().toUpper().constData())
-                                 .arg(QLocale().toCurrencyString(solution->price().getAsInteger()))
+                                 .arg(utils::CurrencyFormatter::instance().format(solution->price()))
                                  .arg(table));
 
     QPrinter printer;
@@ -409,7 +625,7 @@ bool SolutionModel::saveSolution(int index, const QUrl& file)
 
 bool SolutionModel::printSolution(int index)
 {
-    if(index < 0 || index >= solutions_.size())
+    if(index < 0 || index >= rowCount())
     {
         lastError_ = tr("Cannot print configuration: incorrect index %1").arg(index);
         return false;
@@ -428,7 +644,7 @@ bool SolutionModel::printSolution(int index)
                 tr("Configuration ID:") + " %2<br>" + tr("Price:") + " %3</h2></p>"
                 "<h3><table><caption>" + tr("Parameters:") + "</caption>%4</table></h3>");
 
-        Solution* solution = solutions_[index];
+        Solution* solution = solutionAt(index);
         QStringList params = solution->fullDescription().toStringList();
         QString table;
         for(const QString& param : params)
@@ -447,7 +663,7 @@ bool SolutionModel::printSolution(int index)
         QTextDocument document;
         document.setHtml(htmlTemplate.arg(solution->mark() + " " + solution->model())
                                      .arg(solution->hash().toUpper().constData())
-                                     .arg(QLocale().toCurrencyString(solution->price().getAsInteger()))
+                                     .arg(utils::CurrencyFormatter::instance().format(solution->price()))
                                      .arg(table));
         document.print(&printer);
     }
@@ -524,8 +740,12 @@ void SolutionModel::clear()
 {
     beginResetModel();
     qDeleteAll(solutions_);
+    qDeleteAll(sortedRows_);
+    sortedRows_.clear();
     solutionsHash_.clear();
     solutions_.clear();
+    factorizedRows_.clear();
+    factorized_.reset();
     delete tempModel_;
     tempMode_ = false;
     sortOrder_ = -1;
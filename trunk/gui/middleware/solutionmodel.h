@@ -1,9 +1,13 @@
 ﻿#pragma once
 
 #include <QtCore/QAbstractListModel>
+#include <QtCore/QCache>
 #include <QtCore/QFutureWatcher>
+#include <QtCore/QSet>
 #include <QtCore/QUrl>
 
+#include <memory>
+
 #include "nodeitem.h"
 
 namespace vehicle {
@@ -24,6 +28,9 @@ struct SolutionInitializer
     QByteArray hash;
     QString model;
     QString mark;
+    /// Индексы выбранных альтернатив \see SolutionView::choiceIndices();
+    /// пусто для решений, загруженных из файла
+    std::vector<size_t> choices;
 };
 }
 
@@ -31,8 +38,8 @@ struct SolutionInitializer
 /// \class Solution
 /// \brief Класс, представляющий собой решение в
 /// модели решений \c SolutionModel. Может быть инициализирован
-/// тремя способами: 1) передачей в конструктор поддерева решений
-/// из итератора по решениям \see SolutionIterator::currenctSolution();
+/// тремя способами: 1) передачей в конструктор представления решения
+/// из итератора по решениям \see SolutionIterator::currentView();
 /// 2) передачей в конструктор структуры инициализации \see SolutionInitializer
 /// с собственным данными; и 3) путем копирования решения с использованием
 /// конструктора копирования. После создания экземпляра данного класса и его
@@ -41,7 +48,7 @@ struct SolutionInitializer
 class Solution
 {
 public:
-    explicit Solution(solution_iterator::solution_tree_t solution);
+    explicit Solution(const solution_view& solution);
     Solution(internal::SolutionInitializer&& solution);
     Solution(const Solution& solution);
 
@@ -81,9 +88,20 @@ public:
     /// \brief Возвращает идентификатор данной конфигурации
     ///
     inline QByteArray hash() const { return data_.hash; }
+    ///
+    /// \brief Возвращает идентификатор конфигурации \p solution
+    /// (\see hash()) без создания описаний
+    ///
+    static QByteArray hashOf(const solution_view& solution);
+    ///
+    /// \brief Возвращает индексы выбранных альтернатив по разрядам
+    /// \see SolutionView::choiceIndices(); пусто, если решение
+    /// создано не из представления решения
+    ///
+    inline const std::vector<size_t>& choiceIndices() const { return data_.choices; }
 
 private:
-    void initialize(solution_iterator::solution_tree_t solution);
+    void initialize(const solution_view& solution);
 
     internal::SolutionInitializer data_;
 };
@@ -117,9 +135,33 @@ public:
     ///
     /// \brief Статическая функция, предназначения для
     /// генерации модели решений на основе итератора по решениям
-    /// \param solutions - итератор по решениям
+    /// \param solutions - итератор по решениям: \c solution_iterator
+    /// или \c bounded_solution_iterator (только решения в диапазоне цен)
+    /// \note Перебор последовательный (с отсечениями он дешёвый), а строки
+    /// создаются в нескольких потоках \see create(const std::vector<solution_view>&)
+    ///
+    template<typename Iterator>
+    static SolutionModel* create(Iterator solutions, QObject* parent = 0);
+    ///
+    /// \brief Генерация модели из готового списка решений
+    /// (например, найденных \see algorithm::closestSolutions());
+    /// порядок решений в модели совпадает с порядком в списке
+    /// \note Строки (описания и хеши решений) создаются в нескольких
+    /// потоках \see algorithm::WorkStealingPool
     ///
-    static SolutionModel* create(solution_iterator solutions, QObject* parent = 0);
+    static SolutionModel* create(const std::vector<solution_view>& solutions, QObject* parent = 0);
+    ///
+    /// \brief Генерация модели изменений из разности множеств решений:
+    /// модель содержит добавленные решения и хеши удалённых,
+    /// перебираются только изменившиеся решения
+    /// \see algorithm::diffSolutions(), \see recomputeToFit()
+    ///
+    static SolutionModel* create(const solution_diff& diff, QObject* parent = 0);
+    ///
+    /// \brief Генерация модели, строки которой берутся из факторизованного
+    /// множества решений \see setSolutions()
+    ///
+    static SolutionModel* create(std::shared_ptr<const factorized_solutions> solutions, QObject* parent = 0);
 
     explicit SolutionModel(QObject* parent = 0);
     ~SolutionModel();
@@ -132,8 +174,34 @@ public:
     /// текущая модель, после выполнения данной функции
     /// \note \p model должен быть валидным указателем
     /// \note модель \p model не должна быть отсортирована
+    /// \note если \p model - модель изменений (\see create(const solution_diff&)),
+    /// из текущей модели удаляются только удалённые решения
+    /// и добавляются добавленные
     ///
     void recomputeToFit(SolutionModel* model);
+    ///
+    /// \brief Удаляет из модели решения, исключённые фиксацией новых
+    /// значений параметров, без перебора и без создания решений заново
+    /// \param filter - отбор решений по индексам выбранных альтернатив,
+    /// \c filter.isNarrowing() должно быть истинно
+    /// \return false, если у какого-либо решения нет индексов выбранных
+    /// альтернатив или модель факторизована (её множество строится заново
+    /// без перебора \see setSolutions()); модель при этом не изменяется
+    ///
+    bool narrow(const narrowing_filter& filter);
+    ///
+    /// \brief Заменяет решения модели факторизованным множеством решений:
+    /// решения не перебираются и не хранятся, решение строки создаётся
+    /// при обращении к ней (последние созданные кэшируются). Решения
+    /// всех строк создаются только при сортировке, в фоне \see sort()
+    /// \note модель сбрасывается (сигналы modelAboutToBeReset()/modelReset())
+    /// и перестаёт быть сортированной
+    ///
+    void setSolutions(std::shared_ptr<const factorized_solutions> solutions);
+    ///
+    /// \brief Значение "хранит ли модель решения в факторизованном виде?"
+    ///
+    inline bool isFactorized() const { return factorized_ != nullptr; }
 
     ///
     /// \brief Определение чисто виртуального метода базового класса
@@ -146,6 +214,9 @@ public:
     /// т.к. модель - это список, column должна быть равна 0
     /// \param order - тип сортировки
     /// \return Выполняет сортировку модели в соответствии с \p order
+    /// \note Решения факторизованной модели создаются и сортируются в фоне,
+    /// после чего модель сбрасывается; модель с числом решений больше
+    /// предельного (100 000) не сортируется
     ///
     Q_INVOKABLE void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
     ///
@@ -166,6 +237,7 @@ public:
     ///
     /// \brief Добавление решения в модель
     /// \param solution - решение для добавления
+    /// \note модель не должна быть факторизованной
     ///
     void addSolution(Solution* solution);
     ///
@@ -237,12 +309,36 @@ private slots:
 protected:
     QHash<int,QByteArray> roleNames() const;
 
+private:
+    ///
+    /// \brief Возвращает решение строки \p row
+    ///
+    Solution* solutionAt(int row) const;
+    ///
+    /// \brief Создаёт решения \p views в нескольких потоках
+    /// \see algorithm::WorkStealingPool
+    ///
+    static std::vector<Solution*> createSolutions(const std::vector<solution_view>& views);
+    ///
+    /// \brief Создаёт решения \p views в нескольких потоках и добавляет
+    /// их в конец модели в порядке списка
+    ///
+    void appendSolutions(const std::vector<solution_view>& views);
+
 private:
     SolutionModel* tempModel_;
     QString lastError_;
     bool tempMode_;
 
     QHash<QString,Solution*> solutionsHash_;
+    /// Факторизованное множество решений и созданные из него решения строк
+    std::shared_ptr<const factorized_solutions> factorized_;
+    mutable QCache<int,Solution> factorizedRows_;
+    /// Отсортированные в фоне решения факторизованного множества \see endSorting()
+    QVector<Solution*> sortedRows_;
+    /// Хеши удалённых решений модели изменений
+    QSet<QString> removedHashes_;
+    bool diff_;
 	QFutureWatcher<void> sorting_;
     QVector<Solution*> solutions_;
     QHash<int,QByteArray> roles_;
@@ -250,5 +346,16 @@ private:
     bool outdated_;
 };
 
+template<typename Iterator>
+SolutionModel* SolutionModel::create(Iterator solutions, QObject* parent)
+{
+    std::vector<solution_view> views;
+    algorithm::forEachSolution(solutions, [&views](const Iterator& it) {
+        views.push_back(it.currentView());
+        return true;
+    });
+    return create(views, parent);
+}
+
 } // namespace middleware
 } // namespace vehicle
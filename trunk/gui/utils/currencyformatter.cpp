@@ -0,0 +1,76 @@
+﻿#include <QtCore/QGlobalStatic>
+
+#include "currencyformatter.h"
+
+namespace vehicle {
+namespace utils {
+
+// первое обращение происходит из потоков QtConcurrent (\see Solution::initialize()),
+// а статические локальные переменные VS2012 создаются без синхронизации;
+// Q_GLOBAL_STATIC создаёт объект под защитой мьютекса
+Q_GLOBAL_STATIC_WITH_ARGS(CurrencyFormatter, defaultFormatter, (QLocale()))
+
+const CurrencyFormatter& CurrencyFormatter::instance()
+{
+    return *defaultFormatter();
+}
+
+CurrencyFormatter::CurrencyFormatter(const QLocale& locale)
+    : zeroDigit_(locale.zeroDigit().unicode())
+    , groupSeparator_(locale.groupSeparator().unicode())
+    , grouping_(!(locale.numberOptions() & QLocale::OmitGroupSeparator))
+{
+    // образцы записи единицы: по ним находятся префикс и суффикс валюты;
+    // у отрицательной суммы знак минус входит в префикс или суффикс
+    QString one = locale.toString(qlonglong(1));
+    positive_ = patternOf(locale.toCurrencyString(qlonglong(1)), one);
+    negative_ = patternOf(locale.toCurrencyString(qlonglong(-1)), one);
+}
+
+CurrencyFormatter::Pattern CurrencyFormatter::patternOf(const QString& sample, const QString& digits)
+{
+    Pattern pattern;
+    int at = sample.indexOf(digits);
+    Q_ASSERT(at >= 0);
+    if(at >= 0)
+    {
+        pattern.prefix = sample.left(at);
+        pattern.suffix = sample.mid(at + digits.size());
+    }
+    return pattern;
+}
+
+QString CurrencyFormatter::format(qlonglong value) const
+{
+    // 19 цифр и 6 разделителей групп
+    ushort digits[32];
+    ushort* end = digits + sizeof(digits) / sizeof(digits[0]);
+    ushort* begin = end;
+    quint64 magnitude = value < 0 ? 0 - quint64(value) : quint64(value);
+    int count = 0;
+    do
+    {
+        if(grouping_ && count > 0 && count % 3 == 0)
+            *--begin = groupSeparator_;
+        *--begin = ushort(zeroDigit_ + magnitude % 10);
+        magnitude /= 10;
+        ++count;
+    }
+    while(magnitude > 0);
+
+    const Pattern& pattern = value < 0 ? negative_ : positive_;
+    QString result;
+    result.reserve(pattern.prefix.size() + int(end - begin) + pattern.suffix.size());
+    result += pattern.prefix;
+    result.append(reinterpret_cast<const QChar*>(begin), int(end - begin));
+    result += pattern.suffix;
+    return result;
+}
+
+QString CurrencyFormatter::format(const middleware::price_t& price) const
+{
+    return format(qlonglong(price.getAsInteger()));
+}
+
+} // namespace utils
+} // namespace vehicle
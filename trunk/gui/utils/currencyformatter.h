@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <QtCore/QLocale>
+#include <QtCore/QString>
+
+#include "../middleware/nodeitem.h"
+
+namespace vehicle {
+namespace utils {
+
+///
+/// \brief Запись стоимостей в валюте локали, как QLocale::toCurrencyString(),
+/// но без промежуточных строк. Шаблон локали (префикс и суффикс валюты
+/// для положительных и отрицательных сумм, разделитель групп разрядов
+/// и цифры) разбирается один раз при создании, после чего строка
+/// собирается из цифр на стеке за одно выделение памяти
+///
+class CurrencyFormatter
+{
+public:
+    ///
+    /// \brief Возвращает форматирование для локали по умолчанию;
+    /// шаблон разбирается при первом обращении (из любого потока)
+    ///
+    static const CurrencyFormatter& instance();
+
+    explicit CurrencyFormatter(const QLocale& locale);
+
+    ///
+    /// \brief Возвращает целую сумму \p value в валюте локали;
+    /// совпадает с QLocale::toCurrencyString(value)
+    ///
+    QString format(qlonglong value) const;
+
+    ///
+    /// \brief Возвращает стоимость, округлённую до целых, в валюте локали
+    ///
+    QString format(const middleware::price_t& price) const;
+
+private:
+    /// Окружение цифр суммы в записи локали
+    struct Pattern
+    {
+        QString prefix;
+        QString suffix;
+    };
+
+    static Pattern patternOf(const QString& sample, const QString& digits);
+
+    Pattern positive_;
+    Pattern negative_;
+    ushort zeroDigit_;
+    ushort groupSeparator_;
+    bool grouping_;
+};
+
+} // namespace utils
+} // namespace vehicle
@@ -2,6 +2,8 @@
 #include <QtXml/QDomElement>
 #include <QtCore/QFile>
 
+#include <algorithm>
+
 #include "../bridge.h"
 #include "xmlparser.h"
 
@@ -10,6 +12,58 @@ using namespace middleware;
 using namespace core;
 namespace utils {
 
+namespace {
+
+///
+/// \brief Сохраняет числовые атрибуты компонента в виде дочерних
+/// элементов <attribute name="..." value="..."/>
+///
+void writeAttributes(const NodeItem& item, QDomDocument* doc, QDomElement* element)
+{
+    for(auto& attribute : item.attributes())
+    {
+        QDomElement attributeElement = doc->createElement("attribute");
+        attributeElement.setAttribute("name", QString::fromStdString(attribute.first));
+        attributeElement.setAttribute("value", attribute.second);
+        element->appendChild(attributeElement);
+    }
+}
+
+///
+/// \brief Разбирает стоимость из значения атрибута без промежуточных строк
+/// \return false, если значение не является числом (\see core::fromChars());
+/// \p price при этом не меняется
+///
+bool parsePrice(const QString& text, price_t* price)
+{
+    const ushort* begin = text.utf16();
+    const ushort* end = begin + text.size();
+    while(begin != end && QChar(*begin).isSpace())
+        ++begin;
+    while(begin != end && QChar(*(end - 1)).isSpace())
+        --end;
+    price_t parsed;
+    if(fromChars(begin, end, parsed) != end)
+        return false;
+    *price = parsed;
+    return true;
+}
+
+///
+/// \brief Записывает стоимость для атрибута value: целую - как целое
+/// число, как и раньше, иначе с копейками (\see core::toChars())
+///
+QString priceString(const price_t& price)
+{
+    ushort buffer[price_t::maxChars];
+    ushort* end = toChars(buffer, buffer + price_t::maxChars, price);
+    if(price.getUnbiased() % price_t::factor == 0)
+        end = std::find(buffer, end, ushort('.'));
+    return QString::fromUtf16(buffer, int(end - buffer));
+}
+
+} // namespace
+
 // Meyers' singleton is thread-safe in C++11
 XmlParser* XmlParser::instance()
 {
@@ -86,7 +140,7 @@ AOTree* XmlParser::readMarks(QDomElement* andortree)
                     if(!tree)
                     {
                         tree = new AOTree;
-                        tree->setRoot(tree->create(NodeKind::OR, decimal2(0), NodeItem(rootName.toStdString())));
+                        tree->setRoot(tree->create(NodeKind::OR, price_t(0), NodeItem(rootName.toStdString())));
                     }
 
                     if(markElement.attribute("type").compare("AND", Qt::CaseInsensitive) != 0)
@@ -102,7 +156,7 @@ AOTree* XmlParser::readMarks(QDomElement* andortree)
                         break;
                     }
 
-                    AOTree::node_t* markNode = tree->create(NodeKind::AND, decimal2(0), NodeItem(name.toStdString()));
+                    AOTree::node_t* markNode = tree->create(NodeKind::AND, price_t(0), NodeItem(name.toStdString()));
                     tree->getRoot()->attach(markNode);
 
                     if(!readModelElement(&markElement, tree, markNode))
@@ -139,7 +193,7 @@ bool XmlParser::readModelElement(QDomElement* markElement, AOTree* tree, AOTree:
         QString modelName = modelElement.attribute("name");
         if(!modelName.isEmpty())
         {
-            AOTree::node_t* modelNode = tree->create(NodeKind::OR, decimal2(0), NodeItem(modelName.toStdString()));
+            AOTree::node_t* modelNode = tree->create(NodeKind::OR, price_t(0), NodeItem(modelName.toStdString()));
             markNode->attach(modelNode);
 
             QDomElement specificModelElement = modelElement.firstChildElement("node");
@@ -158,11 +212,15 @@ bool XmlParser::readModelElement(QDomElement* markElement, AOTree* tree, AOTree:
                     return false;
                 }
                 QString valueStr = specificModelElement.attribute("value");
-                int value = 0;
+                price_t value;
                 if(!valueStr.isEmpty())
-                    value = valueStr.toInt();
+                    parsePrice(valueStr, &value);
+
+                NodeItem item(name.toStdString());
+                if(!readAttributes(&specificModelElement, &item))
+                    return false;
 
-                AOTree::node_t* specificModelNode = tree->create(kind, decimal2(value), NodeItem(name.toStdString()));
+                AOTree::node_t* specificModelNode = tree->create(kind, value, item);
                 modelNode->attach(specificModelNode);
 
                 if(kind != NodeKind::NONE)
@@ -206,11 +264,15 @@ bool XmlParser::readChildren(QDomElement* element, AOTree* tree, AOTree::node_t*
             return false;
         }
         QString valueStr = elementChild.attribute("value");
-        int value = 0;
+        price_t value;
         if(!valueStr.isEmpty())
-            value = valueStr.toInt();
+            parsePrice(valueStr, &value);
 
-        AOTree::node_t* nodeChild = tree->create(kind, decimal2(value), NodeItem(name.toStdString()));
+        NodeItem item(name.toStdString());
+        if(!readAttributes(&elementChild, &item))
+            return false;
+
+        AOTree::node_t* nodeChild = tree->create(kind, value, item);
         parent->attach(nodeChild);
 
         if(kind != NodeKind::NONE)
@@ -223,6 +285,34 @@ bool XmlParser::readChildren(QDomElement* element, AOTree* tree, AOTree::node_t*
     return true;
 }
 
+bool XmlParser::readAttributes(QDomElement* element, NodeItem* item)
+{
+    Q_ASSERT(element && item);
+
+    QDomElement attributeElement = element->firstChildElement("attribute");
+    while(!attributeElement.isNull())
+    {
+        QString name = attributeElement.attribute("name");
+        if(name.isEmpty())
+        {
+            error_ = QObject::tr("The file %1 is not a correct (attribute at line ") + QString::number(attributeElement.lineNumber()) + QObject::tr(" must have a 'name' attribute)");
+            return false;
+        }
+        bool ok = false;
+        double value = attributeElement.attribute("value").toDouble(&ok);
+        if(!ok)
+        {
+            error_ = QObject::tr("The file %1 is not a correct (a 'value' attribute of attribute at line ") + QString::number(attributeElement.lineNumber()) + QObject::tr(" must contains a number)");
+            return false;
+        }
+        item->setAttribute(name.toStdString(), value);
+
+        attributeElement = attributeElement.nextSiblingElement("attribute");
+    }
+
+    return true;
+}
+
 bool XmlParser::saveModel(AOTree* model, const QString& fileName)
 {
     Q_ASSERT(model);
@@ -244,7 +334,8 @@ bool XmlParser::saveModel(AOTree* model, const QString& fileName)
             QDomElement childElement = doc->createElement("node");
             childElement.setAttribute("name", child->getValue().name().c_str());
             childElement.setAttribute("type", kindToStr.value(child->getKind()));
-            childElement.setAttribute("value", child->ownKey().getAsInteger());
+            childElement.setAttribute("value", priceString(child->ownKey()));
+            writeAttributes(child->getValue(), doc, &childElement);
 
             expandNode(child, doc, &childElement);
             parentElement->appendChild(childElement);
@@ -286,7 +377,8 @@ bool XmlParser::saveModel(AOTree* model, const QString& fileName)
                     QDomElement specificModelElement = xml.createElement("node");
                     specificModelElement.setAttribute("name", childIJK->getValue().name().c_str());
                     specificModelElement.setAttribute("type", kindToStr.value(childIJK->getKind()));
-                    specificModelElement.setAttribute("value", childIJK->ownKey().getAsInteger());
+                    specificModelElement.setAttribute("value", priceString(childIJK->ownKey()));
+                    writeAttributes(childIJK->getValue(), &xml, &specificModelElement);
 
                     expandNode(childIJK, &xml, &specificModelElement);
                     modelElement.appendChild(specificModelElement);
@@ -381,9 +473,8 @@ SolutionModel* XmlParser::loadSolutions(const QString& fileName, bool* isOutdate
                             error_ = QObject::tr("The file %1 is not a correct ('price' element at line %2 must contains a 'value' attribute')").arg(fileName).arg(priceElement.lineNumber());
                             break;
                         }
-                        bool ok = false;
-                        int price = priceStr.toInt(&ok);
-                        if(!ok)
+                        price_t price;
+                        if(!parsePrice(priceStr, &price))
                         {
                             error_ = QObject::tr("The file %1 is not a correct (a 'price' attribute of node at line %2 must contains a number)").arg(fileName).arg(solution.lineNumber());
                             break;
@@ -427,7 +518,7 @@ SolutionModel* XmlParser::loadSolutions(const QString& fileName, bool* isOutdate
 
                         solution = solution.nextSiblingElement("solution");
 
-                        internal::SolutionInitializer data = { fullDescr, shortDescr, decimal2(price), hash.toLocal8Bit(), model, mark };
+                        internal::SolutionInitializer data = { fullDescr, shortDescr, price, hash.toLocal8Bit(), model, mark };
                         Solution* s = new Solution(qMove(data));
                         solutionModel->addSolution(s);
                     }
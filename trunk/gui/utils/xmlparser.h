@@ -55,6 +55,7 @@ private:
     middleware::AOTree* readMarks(QDomElement* andortree);
     bool readModelElement(QDomElement* markElement, middleware::AOTree* tree, middleware::AOTree::node_t* markNode);
     bool readChildren(QDomElement* element, middleware::AOTree* tree, middleware::AOTree::node_t* parent);
+    bool readAttributes(QDomElement* element, middleware::NodeItem* item);
 
     // Singleton routine
     XmlParser() {}